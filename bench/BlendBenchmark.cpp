@@ -0,0 +1,130 @@
+#include <Kernels.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+// Compares every span blending kernel the CPU supports against the scalar one on the sizes of the bundled
+// pictures. Picture sizes are taken from the "<name>-<width>-<height>.png" file names.
+//
+// Usage: blend_benchmark [pics directory] [repetitions]
+
+struct Span {
+  size_t offset;
+  size_t count;
+  uint8_t src[4];
+  uint8_t inv_alpha;
+};
+
+struct Workload {
+  std::string name;
+  int width;
+  int height;
+  std::vector<Span> spans;
+  size_t pixels = 0;
+};
+
+// Spans of random triangles with the same size distribution the solver starts with: vertices uniform over
+// the whole image, so spans are long, plus a set of small triangles as seen late in a run.
+std::vector<Span> MakeSpans(int width, int height, std::mt19937 &gen) {
+  std::uniform_real_distribution<float> coord(0.0f, 1.0f);
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::vector<Span> spans;
+  for (int tr = 0; tr < 200; ++tr) {
+    float scale = tr % 2 ? 1.0f : 0.1f;
+    float cx = coord(gen), cy = coord(gen);
+    float xs[3], ys[3];
+    for (int i = 0; i < 3; ++i) {
+      xs[i] = std::clamp(cx + (coord(gen) - 0.5f) * 2.0f * scale, 0.0f, 1.0f) * width;
+      ys[i] = std::clamp(cy + (coord(gen) - 0.5f) * 2.0f * scale, 0.0f, 1.0f) * height;
+    }
+    uint8_t alpha = byte(gen);
+    uint8_t src[4] = {uint8_t(byte(gen) * alpha / 255), uint8_t(byte(gen) * alpha / 255),
+                      uint8_t(byte(gen) * alpha / 255), uint8_t(alpha * alpha / 255)};
+    int row_begin = static_cast<int>(std::min({ys[0], ys[1], ys[2]}));
+    int row_end = static_cast<int>(std::max({ys[0], ys[1], ys[2]}));
+    for (int row = row_begin; row < row_end; ++row) {
+      float y = row + 0.5f;
+      float lo = width, hi = 0;
+      for (int i = 0; i < 3; ++i) {
+        int j = (i + 1) % 3;
+        if ((ys[i] <= y) != (ys[j] <= y)) {
+          float x = xs[i] + (y - ys[i]) / (ys[j] - ys[i]) * (xs[j] - xs[i]);
+          lo = std::min(lo, x);
+          hi = std::max(hi, x);
+        }
+      }
+      int begin = std::max(0, static_cast<int>(lo + 0.5f));
+      int end = std::min(width, static_cast<int>(hi + 0.5f));
+      if (begin < end) {
+        Span span = {};
+        span.offset = 4 * (static_cast<size_t>(row) * width + begin);
+        span.count = static_cast<size_t>(end - begin);
+        std::memcpy(span.src, src, 4);
+        span.inv_alpha = 255 - alpha;
+        spans.push_back(span);
+      }
+    }
+  }
+  return spans;
+}
+
+double Run(BlendSpanKernel kernel, const Workload &work, std::vector<uint8_t> &pixels, int repetitions) {
+  std::fill(pixels.begin(), pixels.end(), 0);
+  auto start = std::chrono::steady_clock::now();
+  for (int rep = 0; rep < repetitions; ++rep) {
+    for (const Span &span : work.spans) {
+      kernel(pixels.data() + span.offset, span.count, span.src, span.inv_alpha);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char *argv[]) {
+  std::filesystem::path pics = argc > 1 ? argv[1] : PFP_PICS_DIR;
+  int repetitions = argc > 2 ? std::stoi(argv[2]) : 200;
+
+  std::vector<Workload> workloads;
+  std::mt19937 gen(42);
+  for (const auto &entry : std::filesystem::directory_iterator(pics)) {
+    std::string stem = entry.path().stem().string();
+    int width = 0, height = 0;
+    size_t last = stem.rfind('-');
+    size_t prev = last == std::string::npos ? last : stem.rfind('-', last - 1);
+    if (entry.path().extension() != ".png" || prev == std::string::npos) {
+      continue;
+    }
+    width = std::stoi(stem.substr(prev + 1, last - prev - 1));
+    height = std::stoi(stem.substr(last + 1));
+    Workload work = {stem, width, height, MakeSpans(width, height, gen)};
+    for (const Span &span : work.spans) {
+      work.pixels += span.count;
+    }
+    workloads.push_back(std::move(work));
+  }
+  std::sort(workloads.begin(), workloads.end(), [](const Workload &a, const Workload &b) { return a.name < b.name; });
+
+  KernelLevel best = DetectKernelLevel();
+  std::printf("CPU supports up to %s\n", kernel_level_names[best]);
+  for (const Workload &work : workloads) {
+    std::printf("%s (%dx%d): %zu spans, %.1f pixels per span\n", work.name.c_str(), work.width, work.height,
+                work.spans.size(), static_cast<double>(work.pixels) / work.spans.size());
+    std::vector<uint8_t> reference(4 * work.width * work.height);
+    std::vector<uint8_t> pixels(reference.size());
+    double scalar_time = Run(GetBlendSpanKernel(SCALAR), work, reference, repetitions);
+    for (int level = SCALAR; level <= best; ++level) {
+      double time = Run(GetBlendSpanKernel(KernelLevel(level)), work, pixels, repetitions);
+      bool same = pixels == reference;
+      double mpix = static_cast<double>(work.pixels) * repetitions / time / 1e6;
+      std::printf("  %-8s %9.1f Mpix/s  %5.2fx  %s\n", kernel_level_names[level], mpix, scalar_time / time,
+                  same ? "ok" : "MISMATCH");
+    }
+  }
+  return 0;
+}
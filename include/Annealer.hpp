@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <Chromosome.hpp>
+#include <Engine.hpp>
+#include <Rasterizer.hpp>
+#include <RenderBackend.hpp>
+#include <Rng.hpp>
+#include <Solver.hpp>
+#include <ThreadPool.hpp>
+#include <Utils.hpp>
+
+/**
+ * @brief Simulated annealing over a single chromosome
+ *
+ * Every step mutates one triangle (or swaps two) and redraws only the pixels those triangles covered
+ * before or after the change, so the cost of a step depends on the triangles' area and not on the image
+ * size. The candidate slot mirrors the current image outside the redrawn rect: an accepted step copies
+ * the rect into the current slot, a rejected one copies it back and undoes the mutation. Backends without
+ * partial drawing redraw and rescore the whole candidate instead.
+ *
+ * A worse candidate is accepted with probability exp(-delta / T), where delta is the change of the mean
+ * squared error and T follows the chosen schedule. Schedules that reach zero turn into hill climbing.
+ *
+ * The best image is copied whenever an accepted step beats it, only inside the rects changed since the last
+ * copy.
+ *
+ * Iterations report the best image so far as the best fitness, the current one as the mean and the worst
+ * candidate tried during the iteration as the worst.
+ */
+class Annealer : public Engine {
+ public:
+  Annealer(Image image, const SolverOptions &options);
+  IterationResult Iteration() override;
+  void Cleanup() override;
+  GLuint GetBestTexture() const override;
+
+ private:
+  static const size_t kCurrentSlot = 0;
+  static const size_t kCandidateSlot = 1;
+  static const size_t kBestSlot = 2;
+
+  // one mutation tried and either kept or undone, returns the candidate's squared error
+  uint64_t Step_();
+  double Temperature_() const;
+  uint64_t ScoreSlot_(size_t slot);
+
+  Image image_;
+  size_t pixel_count_;
+  bool skip_alpha_;
+  size_t steps_per_iteration_;
+  ScheduleType schedule_;
+  size_t schedule_length_;
+  double temperature_;
+  bool initialized_ = false;
+
+  Rng rng_;
+  Chromosome current_;
+  uint64_t squared_error_ = 0;
+  uint64_t best_squared_error_ = 0;
+  // where the current image may differ from the best one
+  Rect best_dirty_;
+  size_t step_ = 0;
+  size_t iteration_ = 0;
+
+  ThreadPool *Pool_;
+  RenderBackend *Backend_;
+};
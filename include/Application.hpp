@@ -9,6 +9,7 @@
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 #include <Utils.hpp>
+#include <Engine.hpp>
 #include <Solver.hpp>
 
 class Application {
@@ -37,5 +38,5 @@ class Application {
 
   Image image_;
   bool running_ = false;
-  Solver solver_;
+  std::unique_ptr<Engine> engine_;
 };
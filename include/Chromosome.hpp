@@ -1,33 +1,134 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <glad/glad.h>
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
+#include <Rng.hpp>
+
+class RenderBackend;
+class PopulationStore;
+struct Rect;
 
 struct Triangle {
   glm::vec2 vs[3];
   glm::vec4 color;
 };
 
+/**
+ * @brief Read only view of consecutive triangles
+ */
+struct TriangleSpan {
+  const Triangle *data;
+  size_t count;
+
+  const Triangle *begin() const { return data; }
+  const Triangle *end() const { return data + count; }
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  const Triangle &operator[](size_t idx) const { return data[idx]; }
+};
+
+/**
+ * @brief A triangle replaced by a mutation together with its value before the mutation
+ */
+struct TriangleChange {
+  size_t index;
+  Triangle before;
+};
+
+/**
+ * @brief A genome of triangles drawn in order, with its fitness and render lineage
+ *
+ * The triangles either live in the chromosome's own vector or, for chromosomes of a PopulationStore, in the
+ * store's arena. Assigning to a chromosome copies the triangles into the storage it already has, so
+ * chromosomes of a store never reallocate and stay bound to their arena, copies of them are self-contained.
+ */
 class Chromosome {
  public:
+  static const size_t kNoSlot = static_cast<size_t>(-1);
+
   Chromosome() = default;
-  Chromosome(const size_t size);
+  Chromosome(const size_t size, Rng &rng);
   Chromosome(std::vector<Triangle> triangles);
+  Chromosome(const Chromosome &other);
+  Chromosome(Chromosome &&other);
+  Chromosome &operator=(const Chromosome &other);
+  Chromosome &operator=(Chromosome &&other);
 
-  void Mutate();
-  void Draw(GLuint buffer, int image_width, int image_height);
+  void Mutate(Rng &rng);
+  void Draw(RenderBackend &backend, size_t slot) const;
 
-  const std::vector<Triangle> &GetTriangles() const;
+  TriangleSpan GetTriangles() const;
+  size_t GetSize() const;
+  /**
+   * @brief Writable triangles for rebuilding the genome wholesale, e.g. by crossover. The fitness and the
+   * render lineage are dropped since they no longer describe it
+   */
+  Triangle *Overwrite();
   void SetFitness(float fitness);
   float GetFitness() const;
+  /**
+   * @brief 64-bit hash of the triangles, equal for equal genomes however they came about. Computed on first
+   * use and kept up to date by Mutate
+   */
+  uint64_t GetHash() const;
 
   const Triangle &operator[](const size_t idx) const;
 
+  /**
+   * @brief Remember that the genome as it is now was rendered into a backend slot with a given error.
+   * Copies inherit this, and mutations made afterwards are recorded so the copy can be redrawn
+   * incrementally from that slot.
+   *
+   * @param slot
+   * @param squared_error
+   */
+  void SetRendered(size_t slot, uint64_t squared_error);
+  /**
+   * @brief Slot holding the image this genome was derived from, or kNoSlot if it must be drawn from scratch
+   */
+  size_t GetRenderSlot() const;
+  uint64_t GetSquaredError() const;
+  /**
+   * @brief Triangles changed since the image in GetRenderSlot(), in the order they were changed
+   */
+  const std::vector<TriangleChange> &GetChanges() const;
+  /**
+   * @brief Pixels of a width x height image covered by a changed triangle before or after its change, the
+   * only ones where the genome's image can differ from the one in GetRenderSlot()
+   */
+  Rect GetDirtyRect(int width, int height) const;
+  /**
+   * @brief Take back the changes made since SetRendered, so the genome matches the image in GetRenderSlot()
+   * again. Does nothing once the lineage is lost
+   */
+  void Undo();
+
  private:
+  friend class PopulationStore;
   enum MutationType { COLOR, ORDER, POSITION, LAST };
 
-  std::vector<Triangle> triangles_;
+  // point the chromosome at size triangles of an arena, they are left as they are
+  void Bind_(Triangle *triangles, size_t size);
+  void CopyState_(const Chromosome &other);
+
+  Triangle *triangles_ = nullptr;
+  size_t size_ = 0;
+  // backs triangles_ unless the chromosome is bound to an arena
+  std::vector<Triangle> storage_;
+  bool bound_ = false;
   float fitness_ = INFINITY;
+
+  void RecordChange_(size_t idx);
+  // take a triangle out of the hash before changing it and put it back afterwards
+  void Unhash_(size_t idx);
+  void Rehash_(size_t idx);
+  // sum of a hash of every triangle with its index, so changing one triangle updates it in O(1)
+  mutable uint64_t hash_ = 0;
+  mutable bool hash_valid_ = false;
+  size_t render_slot_ = kNoSlot;
+  uint64_t squared_error_ = 0;
+  std::vector<TriangleChange> changes_;
 };
\ No newline at end of file
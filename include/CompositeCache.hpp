@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <Chromosome.hpp>
+#include <Rasterizer.hpp>
+
+class ThreadPool;
+
+/**
+ * @brief Prefix images and suffix blend maps of one chromosome, for redrawing copies of it that differ in a
+ * few triangles
+ *
+ * Source-over blending is affine per pixel, so all triangles from index s on collapse into
+ * out = color + transmittance * in. At checkpoints every GetStride() triangles the cache keeps the composite
+ * of the triangles below the checkpoint and this map for the ones above it. A copy whose triangles [lo, hi]
+ * changed is redrawn from the prefix at or below lo, the triangles up to the next checkpoint above hi and
+ * the suffix map there, so its cost depends on the stride and not on the genome size.
+ *
+ * The suffix map is applied in float and rounded once instead of rounding after every triangle like the
+ * 8-bit blend does, so pixels drawn through the cache may differ from a full draw by a few units.
+ */
+class CompositeCache {
+ public:
+  /**
+   * @brief Rebuild the cache for a chromosome drawn into a width x height image
+   *
+   * @param chromosome
+   * @param width
+   * @param height
+   * @param pool spreads the work over horizontal bands, may be nullptr
+   * @return false if even two checkpoints do not fit into the memory budget
+   */
+  bool Build(const Chromosome &chromosome, int width, int height, ThreadPool *pool = nullptr);
+
+  /**
+   * @brief Draw a copy of the cached chromosome whose changed triangles all lie in [lo, hi], inside clip only
+   *
+   * @param chromosome the copy, same size as the cached chromosome
+   * @param lo
+   * @param hi
+   * @param clip
+   * @param pixels RGBA8 image of the same size as the cache
+   */
+  void Draw(const Chromosome &chromosome, size_t lo, size_t hi, const Rect &clip, uint8_t *pixels) const;
+
+  bool IsEmpty() const;
+  void Clear();
+  size_t GetStride() const;
+
+ private:
+  struct SuffixPixel {
+    float color[4];
+    float transmittance;
+  };
+
+  // checkpoint m sits in front of triangle min(m * stride_, size_)
+  size_t Checkpoint_(size_t m) const;
+  void BuildBand_(const Rect &band);
+
+  int width_ = 0;
+  int height_ = 0;
+  size_t size_ = 0;
+  size_t stride_ = 0;
+  std::vector<std::vector<uint8_t>> prefixes_;
+  std::vector<std::vector<SuffixPixel>> suffixes_;
+  // triangle setups of the last build, kept so rebuilding for the next elite does not allocate
+  std::vector<RasterTriangle> setups_;
+  std::vector<uint8_t> visible_;
+};
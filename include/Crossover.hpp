@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Chromosome.hpp>
+#include <Rng.hpp>
 
 enum CrossoverType { ONE_POINT, TWO_POINT, UNIFORM, NONE };
 
@@ -8,25 +9,42 @@ extern const char *crossover_type_names[4];
 
 class CrossoverStrategy {
  public:
-  virtual Chromosome operator()(const Chromosome &child1, const Chromosome &child2) = 0;
+  /**
+   * @brief Breed two parents into an existing chromosome of the same size, without allocating
+   *
+   * @param parent1
+   * @param parent2
+   * @param child must not be one of the parents
+   * @param rng
+   */
+  virtual void operator()(const Chromosome &parent1, const Chromosome &parent2, Chromosome &child, Rng &rng) = 0;
+  virtual ~CrossoverStrategy() = default;
 };
 
 class OnePointCrossoverStrategy : public CrossoverStrategy {
  public:
-  Chromosome operator()(const Chromosome &child1, const Chromosome &child2) override;
+  void operator()(const Chromosome &parent1, const Chromosome &parent2, Chromosome &child, Rng &rng) override;
 };
 
 class TwoPointCrossoverStrategy : public CrossoverStrategy {
  public:
-  Chromosome operator()(const Chromosome &child1, const Chromosome &child2) override;
+  void operator()(const Chromosome &parent1, const Chromosome &parent2, Chromosome &child, Rng &rng) override;
 };
 
 class UniformCrossoverStrategy : public CrossoverStrategy {
  public:
-  Chromosome operator()(const Chromosome &child1, const Chromosome &child2) override;
+  void operator()(const Chromosome &parent1, const Chromosome &parent2, Chromosome &child, Rng &rng) override;
 };
 
 class NoneCrossoverStrategy : public CrossoverStrategy {
  public:
-  Chromosome operator()(const Chromosome &child1, const Chromosome &child2) override;
-};
\ No newline at end of file
+  void operator()(const Chromosome &parent1, const Chromosome &parent2, Chromosome &child, Rng &rng) override;
+};
+
+/**
+ * @brief Create the crossover strategy of the given type
+ *
+ * @param type
+ * @return CrossoverStrategy* owned by the caller
+ */
+CrossoverStrategy *CreateCrossover(CrossoverType type);
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <Utils.hpp>
+
+struct SolverOptions;
+
+struct IterationResult {
+  size_t iteration;
+  // the best image found so far, the one GetBestTexture returns
+  GLuint texture;
+  float best_fitness;
+  float worst_fitness;
+  float mean_fitness;
+  // pyramid level the fitness was measured at, 0 is full resolution
+  size_t level;
+};
+
+enum EngineType { GENETIC, ANNEALING, EVOLUTION_STRATEGY, STEADY_STATE };
+
+extern const char *engine_names[4];
+
+/**
+ * @brief Cooling schedules of the annealing engine, see schedule_names
+ */
+enum ScheduleType {
+  GEMAN_1,
+  GEMAN_50,
+  GEMAN_195075,
+  LINEAR,
+  STAIRCASE,
+  SIGMOID,
+  GEOMETRIC,
+  LINEAR_REHEAT,
+  COSINE
+};
+
+extern const char *schedule_names[9];
+
+/**
+ * @brief Where islands send their migrants: the next island of a fixed ring, or of a ring through the
+ * islands in a new random order at every migration
+ */
+enum MigrationTopology { RING, RANDOM_RING };
+
+extern const char *migration_topology_names[2];
+
+/**
+ * @brief A search that improves a set of triangles towards a target image one iteration at a time
+ */
+class Engine {
+ public:
+  virtual ~Engine() = default;
+  virtual IterationResult Iteration() = 0;
+  virtual void Cleanup() = 0;
+  virtual GLuint GetBestTexture() const = 0;
+};
+
+/**
+ * @brief Create the engine picked by options.engine. GL backends get an offscreen context if no window made
+ * one current, and fall back to the software backend if that fails too
+ *
+ * @param image
+ * @param options
+ * @return Engine* owned by the caller, who has to call Cleanup before deleting it
+ */
+Engine *CreateEngine(Image image, const SolverOptions &options);
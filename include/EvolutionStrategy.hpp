@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+#include <Chromosome.hpp>
+#include <Engine.hpp>
+#include <Rasterizer.hpp>
+#include <RenderBackend.hpp>
+#include <Solver.hpp>
+#include <ThreadPool.hpp>
+#include <Utils.hpp>
+
+/**
+ * @brief (1 + lambda) evolution strategy: one parent, lambda single-mutation children per generation, and
+ * the best child replaces the parent only if it has a smaller squared error
+ *
+ * The parent's image stays in its slot (with a CompositeCache when composite_cache is set) and every child
+ * slot mirrors it outside the rect its last child changed. A child is drawn over just the rect its mutation
+ * touched and scored by the change of the error inside it, so children are bred, drawn and scored in
+ * parallel on backends that allow it, and a generation allocates nothing. Backends without partial drawing
+ * draw all children in one DrawBatch and score them with ComputeSquaredErrors where possible.
+ *
+ * Iterations report the parent as the best fitness and the mean and worst fitness of the children.
+ */
+class EvolutionStrategy : public Engine {
+ public:
+  EvolutionStrategy(Image image, const SolverOptions &options);
+  IterationResult Iteration() override;
+  void Cleanup() override;
+  GLuint GetBestTexture() const override;
+
+ private:
+  static const size_t kParentSlot = 0;
+
+  void EvaluatePartial_();
+  void EvaluateFull_();
+
+  Image image_;
+  size_t pixel_count_;
+  bool skip_alpha_;
+  bool composite_cache_;
+  size_t lambda_;
+  uint64_t seed_;
+  size_t iteration_ = 0;
+  bool initialized_ = false;
+
+  Chromosome parent_;
+  uint64_t squared_error_ = 0;
+  // child i lives in slot 1 + i, rects_[i] is where its image differs from the parent's
+  std::vector<Chromosome> children_;
+  std::vector<uint64_t> errors_;
+  std::vector<Rect> rects_;
+
+  ThreadPool *Pool_;
+  RenderBackend *Backend_;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <Rasterizer.hpp>
+#include <Utils.hpp>
+
+/**
+ * @brief Squared error of the pixels inside rect against the same pixels of the target
+ *
+ * @param target
+ * @param pixels RGBA8 image the size of the target
+ * @param rect
+ * @param skip_alpha leave the alpha channel out
+ * @return uint64_t
+ */
+uint64_t CalcSquaredError(const Image &target, const GLubyte *pixels, const Rect &rect, bool skip_alpha);
+
+/**
+ * @brief Fitness of an image of pixel_count pixels with the given squared error: the number of compared values
+ * over the mean squared error. Every engine reports this, so their fitness values compare
+ *
+ * @param squared_error
+ * @param pixel_count
+ * @param skip_alpha whether the error left the alpha channel out
+ * @return double
+ */
+double SquaredErrorFitness(uint64_t squared_error, size_t pixel_count, bool skip_alpha);
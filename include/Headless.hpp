@@ -0,0 +1,33 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <Solver.hpp>
+
+/**
+ * @brief Runs the solver from the command line without creating a window
+ *
+ * Usage: app --headless <image> [--iterations N] [--population N] [--genome N] [--cleansing-rate F]
+ *                              [--skip-alpha] [--threads N] [--composite-cache]
+ *                              [--backend software|opengl|opengl-layered] [--coarse-levels N] [--stall N]
+ *                              [--racing F] [--racing-budget F] [--early-abort] [--memo] [--seed N]
+ *                              [--engine ga|sa|es|ss] [--schedule NAME] [--schedule-length N] [--temperature F]
+ *                              [--islands N] [--migration-interval N] [--migrants N] [--topology ring|random]
+ *
+ * The GL backends run on an offscreen EGL context, e.g. Mesa llvmpipe on machines without a display.
+ */
+class Headless {
+ public:
+  Headless(int argc, char *argv[]);
+  int Run();
+
+ private:
+  void InitLogging();
+  bool ParseArguments(int argc, char *argv[]);
+  bool ParseOption(const std::string &arg, const char *value);
+
+  bool valid_ = false;
+  std::filesystem::path input_path_;
+  size_t iterations_ = 1000;
+  SolverOptions options_;
+};
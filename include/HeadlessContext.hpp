@@ -0,0 +1,19 @@
+#pragma once
+
+/**
+ * @brief Offscreen GL context for running the GL backends without a window or display server
+ *
+ * Created through EGL, preferring the Mesa surfaceless platform (no surface at all, works with llvmpipe on
+ * machines without a GPU) and falling back to the default display with a 1x1 pbuffer. The context is
+ * created once per process, asks for a 4.5 compatibility profile first and gets the same blend state and
+ * clear color as the GUI context. Builds without EGL report failure.
+ */
+class HeadlessContext {
+ public:
+  /**
+   * @brief Create the context on first use, make it current on the calling thread and load GL through glad
+   *
+   * @return false if no EGL display could provide a GL context
+   */
+  static bool MakeCurrent();
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <Chromosome.hpp>
+#include <Engine.hpp>
+#include <Solver.hpp>
+#include <ThreadPool.hpp>
+#include <Utils.hpp>
+
+/**
+ * @brief Island model: several genetic algorithm populations evolving side by side, with the fittest
+ * individuals of each copied to a neighbour every few generations
+ *
+ * Every island is a Solver of its own with a single thread, its own backend, seed and buffers, and the
+ * islands of a generation run as one parallel loop, so nothing is shared while they breed and score. With a
+ * GL backend the islands share the context of the calling thread and run one after another.
+ *
+ * Migrants travel through mailboxes with a single sender and a single receiver. The sender fills one only
+ * while it is empty and publishes it with a release store, the receiving island takes the migrants at the
+ * start of its next generation and empties it again, so islands never block on each other. Every island has
+ * two mailboxes, one for the migrants sent in even and one for those sent in odd generations, so whatever
+ * order the islands of a generation run in, migrants arrive exactly one generation after they were sent and
+ * runs stay reproducible.
+ *
+ * Iterations report the best and worst fitness over all islands, the mean of the islands' means and the
+ * best image any island has found so far.
+ */
+class IslandSolver : public Engine {
+ public:
+  IslandSolver(Image image, const SolverOptions &options);
+  IterationResult Iteration() override;
+  void Cleanup() override;
+  GLuint GetBestTexture() const override;
+
+ private:
+  struct Mailbox {
+    std::vector<Chromosome> migrants;
+    std::atomic<bool> full{false};
+  };
+
+  // one generation of island k, with the migrants it got before and the ones it sends after
+  void RunIsland_(size_t k, bool migrate);
+  void PlanMigration_();
+
+  size_t migration_interval_;
+  size_t migrants_;
+  MigrationTopology topology_;
+  uint64_t seed_;
+  bool parallel_;
+  bool initialized_ = false;
+  size_t iteration_ = 0;
+
+  std::vector<Solver *> islands_;
+  // mailboxes_[2 * k + g % 2] holds what was sent to island k in generation g
+  std::vector<Mailbox> mailboxes_;
+  // island k sends its migrants to targets_[k]
+  std::vector<size_t> targets_;
+  std::vector<IterationResult> results_;
+  // island holding the best image so far
+  size_t best_island_ = 0;
+
+  ThreadPool *Pool_;
+};
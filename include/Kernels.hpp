@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Instruction set tiers of the SIMD kernels, every tier includes the ones below it
+ */
+enum KernelLevel { SCALAR, SSE2, AVX2, AVX512, KERNEL_LEVEL_COUNT };
+
+extern const char *kernel_level_names[KERNEL_LEVEL_COUNT];
+
+/**
+ * @brief Find the best kernel level supported by this CPU, queried with cpuid
+ *
+ * @return KernelLevel
+ */
+KernelLevel DetectKernelLevel();
+
+/**
+ * @brief Source-over blend of one color into a run of RGBA8 pixels, dst = src + dst * inv_alpha / 255
+ *
+ * @param dst first pixel of the span
+ * @param count number of pixels
+ * @param src color already weighted by alpha, src * alpha / 255 per channel
+ * @param inv_alpha 255 - alpha
+ */
+using BlendSpanKernel = void (*)(uint8_t *dst, size_t count, const uint8_t src[4], uint8_t inv_alpha);
+
+/**
+ * @brief Get the span blending kernel of a given level, falls back to lower levels the build lacks
+ *
+ * @param level
+ * @return BlendSpanKernel
+ */
+BlendSpanKernel GetBlendSpanKernel(KernelLevel level);
+
+/**
+ * @brief Span blending kernel picked for this CPU at startup
+ */
+extern const BlendSpanKernel BlendSpan;
+
+/**
+ * @brief Sum of squared differences between two RGBA8 pixel runs
+ *
+ * @param a
+ * @param b
+ * @param count number of pixels
+ * @param skip_alpha ignore the fourth channel of every pixel
+ * @return uint64_t
+ */
+using SquaredErrorKernel = uint64_t (*)(const uint8_t *a, const uint8_t *b, size_t count, bool skip_alpha);
+
+SquaredErrorKernel GetSquaredErrorKernel(KernelLevel level);
+
+/**
+ * @brief Squared error kernel picked for this CPU at startup
+ */
+extern const SquaredErrorKernel SquaredError;
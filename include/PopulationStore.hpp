@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <Chromosome.hpp>
+
+/**
+ * @brief Two generations of equally sized chromosomes, each generation's triangles in one contiguous arena
+ *
+ * The next generation is bred into GetNext() while the parents in GetCurrent() are read in place, then Swap()
+ * makes it current. The chromosomes stay bound to their arena, so assigning to them copies triangles without
+ * allocating. The store is only the genomes' part: the solver keeps its selection, scoring and memo buffers
+ * across generations too, so once the first generation has sized them a generation on the software backend
+ * makes no heap allocations, whichever selection, crossover and scoring options are on.
+ *
+ * Triangles are stored as structs rather than one array per coordinate: every renderer reads them one
+ * whole triangle at a time in genome order, and mutations touch single triangles.
+ */
+class PopulationStore {
+ public:
+  PopulationStore() = default;
+  PopulationStore(size_t population_size, size_t genome_size);
+
+  // chromosomes point into the arenas, which keep their address only when moved
+  PopulationStore(const PopulationStore &) = delete;
+  PopulationStore &operator=(const PopulationStore &) = delete;
+  PopulationStore(PopulationStore &&) = default;
+  PopulationStore &operator=(PopulationStore &&) = default;
+
+  std::vector<Chromosome> &GetCurrent();
+  const std::vector<Chromosome> &GetCurrent() const;
+  std::vector<Chromosome> &GetNext();
+  void Swap();
+
+  Chromosome &operator[](size_t idx);
+  const Chromosome &operator[](size_t idx) const;
+  size_t GetSize() const;
+
+ private:
+  std::vector<Triangle> arenas_[2];
+  std::vector<Chromosome> generations_[2];
+  size_t current_ = 0;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <Chromosome.hpp>
+
+/**
+ * @brief Half-open pixel rectangle [x0, x1) x [y0, y1)
+ */
+struct Rect {
+  int x0 = 0;
+  int y0 = 0;
+  int x1 = 0;
+  int y1 = 0;
+
+  bool IsEmpty() const;
+  size_t Area() const;
+  Rect Intersect(const Rect &other) const;
+  Rect Union(const Rect &other) const;
+};
+
+/**
+ * @brief A triangle prepared for rasterization: fixed-point edge equations, bounds and blend terms
+ *
+ * Vertices are snapped to 1/256 of a pixel. Edge i is a[i] * x + b[i] * y + c[i] in subpixel units,
+ * positive inside, and a pixel belongs to the triangle when all three are >= bias[i] at its centre.
+ */
+struct RasterTriangle {
+  int64_t a[3], b[3], c[3], bias[3];
+  Rect bounds;
+  uint8_t src[4];
+  uint8_t inv_alpha;
+};
+
+/**
+ * @brief Prepare a triangle for drawing into a width x height image
+ *
+ * @return false when the triangle does not touch any pixel or is fully transparent
+ */
+bool SetupTriangle(const Triangle &tr, int width, int height, RasterTriangle &out);
+
+/**
+ * @brief Pixels a triangle may change when drawn into a width x height image, empty if it changes none
+ */
+Rect TriangleBounds(const Triangle &tr, int width, int height);
+
+/**
+ * @brief Call fn(row, begin, end) for every row of the triangle inside clip with covered pixels [begin, end)
+ */
+template <typename SpanFn>
+void ForEachSpan(const RasterTriangle &tr, const Rect &clip, SpanFn &&fn);
+
+/**
+ * @brief Blend a prepared triangle into an RGBA8 image, touching only pixels inside clip
+ *
+ * @param tr
+ * @param clip
+ * @param width row length of the image in pixels
+ * @param pixels
+ */
+void DrawTriangle(const RasterTriangle &tr, const Rect &clip, int width, uint8_t *pixels);
+
+/**
+ * @brief Fill a rectangle of an RGBA8 image with opaque black, the clear color of the GL path
+ */
+void ClearPixels(const Rect &rect, int width, uint8_t *pixels);
+
+namespace rasterizer_detail {
+
+const int64_t kSubpixelBits = 8;
+const int64_t kSubpixel = 1 << kSubpixelBits;
+
+inline int64_t FloorDiv(int64_t a, int64_t b) {
+  int64_t q = a / b;
+  return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+}
+
+inline int64_t CeilDiv(int64_t a, int64_t b) {
+  return -FloorDiv(-a, b);
+}
+
+}  // namespace rasterizer_detail
+
+template <typename SpanFn>
+void ForEachSpan(const RasterTriangle &tr, const Rect &clip, SpanFn &&fn) {
+  using namespace rasterizer_detail;
+  Rect box = tr.bounds.Intersect(clip);
+  for (int row = box.y0; row < box.y1; ++row) {
+    int64_t yc = row * kSubpixel + kSubpixel / 2;
+    int64_t begin = box.x0;
+    int64_t end = box.x1;
+    for (int i = 0; i < 3 && begin < end; ++i) {
+      // a * (px * kSubpixel + kSubpixel / 2) + b * yc + c >= bias
+      int64_t rhs = tr.bias[i] - tr.b[i] * yc - tr.c[i] - tr.a[i] * (kSubpixel / 2);
+      if (tr.a[i] > 0) {
+        begin = std::max(begin, CeilDiv(rhs, tr.a[i] * kSubpixel));
+      } else if (tr.a[i] < 0) {
+        end = std::min(end, FloorDiv(rhs, tr.a[i] * kSubpixel) + 1);
+      } else if (rhs > 0) {
+        end = begin;
+      }
+    }
+    if (begin < end) {
+      fn(row, static_cast<int>(begin), static_cast<int>(end));
+    }
+  }
+}
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <Chromosome.hpp>
+#include <CompositeCache.hpp>
+#include <Rasterizer.hpp>
+
+class ThreadPool;
+
+enum RenderBackendType { OPENGL, SOFTWARE, OPENGL_LAYERED };
+
+extern const char *render_backend_names[3];
+
+/**
+ * @brief Renders chromosomes into a fixed set of RGBA8 slots, each the size of the target image.
+ *
+ * Pixels are laid out row by row starting at the bottom row (NDC y = -1), which is the same layout
+ * glGetTextureImage produces and the same one the target image uses after LoadTextureFromFile.
+ */
+class RenderBackend {
+ public:
+  RenderBackend(int width, int height, size_t slots);
+  virtual ~RenderBackend() = default;
+
+  /**
+   * @brief Clear a slot to opaque black and composite all triangles of a chromosome into it
+   *
+   * @param chromosome
+   * @param slot
+   */
+  virtual void Draw(const Chromosome &chromosome, size_t slot) = 0;
+
+  /**
+   * @brief Draw a whole population into consecutive slots, by default one Draw after another
+   *
+   * @param chromosomes
+   * @param first_slot slot of chromosomes[0]
+   */
+  virtual void DrawBatch(const std::vector<Chromosome> &chromosomes, size_t first_slot);
+
+  /**
+   * @brief Render a chromosome that differs from the image in another slot only inside rect: copy that
+   * image and recomposite the chromosome over just the rect
+   *
+   * @param chromosome
+   * @param from slot with an image that matches the chromosome outside rect
+   * @param slot
+   * @param rect
+   * @return false if the backend cannot draw partially, the caller should Draw the whole slot instead
+   */
+  virtual bool DrawRegion(const Chromosome &chromosome, size_t from, size_t slot, const Rect &rect);
+
+  /**
+   * @brief DrawRegion for a slot that already holds the image of from outside rect, so only the rect is
+   * touched. By default the whole image is copied like DrawRegion does
+   *
+   * @param chromosome
+   * @param from slot the chromosome was derived from, e.g. the cached one
+   * @param slot
+   * @param rect
+   * @return false if the backend cannot draw partially
+   */
+  virtual bool RedrawRegion(const Chromosome &chromosome, size_t from, size_t slot, const Rect &rect);
+
+  /**
+   * @brief Prepare for many DrawRegion calls from a slot, e.g. the one holding the elite of a generation
+   *
+   * @param chromosome the chromosome drawn into the slot
+   * @param slot
+   * @return false if the backend keeps no such cache
+   */
+  virtual bool CacheSlot(const Chromosome &chromosome, size_t slot);
+
+  /**
+   * @brief Get the RGBA8 pixels of a slot, valid until the next call on this backend
+   *
+   * @param slot
+   * @return const GLubyte*
+   */
+  virtual const GLubyte *GetPixels(size_t slot) = 0;
+
+  /**
+   * @brief Copy the RGBA8 pixels of a slot into caller owned memory
+   *
+   * @param slot
+   * @param pixels receives width * height * 4 bytes
+   */
+  virtual void ReadPixels(size_t slot, GLubyte *pixels) = 0;
+
+  /**
+   * @brief How many more reads than one may be begun and not yet ended
+   */
+  static const size_t kReadAhead = 2;
+
+  /**
+   * @brief Start fetching a slot's pixels without waiting for them. Reads are ended in the order they were
+   * begun and at most kReadAhead + 1 may be outstanding
+   *
+   * @param slot
+   */
+  virtual void BeginReadPixels(size_t slot);
+
+  /**
+   * @brief Wait for the oldest outstanding read, by default this is a plain GetPixels
+   *
+   * @param slot the slot of that read
+   * @return const GLubyte* valid until the next BeginReadPixels
+   */
+  virtual const GLubyte *EndReadPixels(size_t slot);
+
+  /**
+   * @brief Whether Draw, GetPixels and ReadPixels may run concurrently for different slots
+   */
+  virtual bool IsThreadSafe() const;
+
+  virtual void CopySlot(size_t from, size_t to) = 0;
+
+  /**
+   * @brief Copy only the pixels inside rect, by default the whole slot
+   *
+   * @param from
+   * @param to
+   * @param rect
+   */
+  virtual void CopyRegion(size_t from, size_t to, const Rect &rect);
+
+  /**
+   * @brief Hand the target image to the backend for ComputeSquaredErrors
+   *
+   * @param pixels RGBA8 target in the slot layout, width * height * 4 bytes
+   * @param skip_alpha leave the fourth channel out of the error
+   */
+  virtual void SetTarget(const GLubyte *pixels, bool skip_alpha);
+
+  /**
+   * @brief Sum of squared differences against the target for every slot in [first_slot, first_slot + count),
+   * computed where the images live so only the sums travel back
+   *
+   * @param first_slot
+   * @param count
+   * @param errors receives count sums
+   * @return false if the backend cannot do this, the caller should read the pixels back instead
+   */
+  virtual bool ComputeSquaredErrors(size_t first_slot, size_t count, uint64_t *errors);
+
+  /**
+   * @brief Whether ComputeSquaredErrors works, so callers can plan around reading pixels back
+   */
+  virtual bool CanComputeSquaredErrors() const;
+
+  /**
+   * @brief Get a GL texture holding the slot's image for display. Only call it on the thread of the GL
+   * context, backends that draw on other threads bring the texture up to date here
+   *
+   * @param slot
+   * @return GLuint texture name, or -1 if the backend runs without a GL context
+   */
+  virtual GLuint GetTexture(size_t slot) = 0;
+
+  int GetWidth() const;
+  int GetHeight() const;
+
+ protected:
+  int width_;
+  int height_;
+  size_t slots_;
+  size_t buffer_size_;
+};
+
+/**
+ * @brief Hardware rendering into one framebuffer per slot, needs a current GL context
+ *
+ * On GL 3.3 and newer a chromosome is written into a vertex buffer and drawn by a small shader program in
+ * a single glDrawArrays. With GL 4.4 the buffer is persistently mapped and split into a ring of regions
+ * guarded by fences, so filling the next chromosome never waits for the previous draw; older versions
+ * orphan and refill the buffer with glBufferSubData. Contexts below 3.3 fall back to immediate mode.
+ *
+ * In layered mode (GL 4.5) the slots are the layers of one GL_TEXTURE_2D_ARRAY behind a single layered
+ * framebuffer. Every vertex carries the layer of its individual and a geometry shader routes the triangle
+ * there through gl_Layer, so DrawBatch renders a whole population with one clear and one draw call.
+ * Primitives are blended in submission order within each layer, so the images are the same as drawing
+ * the slots one by one. Slots are shown through 2D texture views of their layer.
+ */
+class OpenGLRenderBackend : public RenderBackend {
+ public:
+  OpenGLRenderBackend(int width, int height, size_t slots, bool layered = false);
+  ~OpenGLRenderBackend() override;
+
+  void Draw(const Chromosome &chromosome, size_t slot) override;
+  void DrawBatch(const std::vector<Chromosome> &chromosomes, size_t first_slot) override;
+  const GLubyte *GetPixels(size_t slot) override;
+  void ReadPixels(size_t slot, GLubyte *pixels) override;
+  void BeginReadPixels(size_t slot) override;
+  const GLubyte *EndReadPixels(size_t slot) override;
+  void CopySlot(size_t from, size_t to) override;
+  void SetTarget(const GLubyte *pixels, bool skip_alpha) override;
+  bool ComputeSquaredErrors(size_t first_slot, size_t count, uint64_t *errors) override;
+  bool CanComputeSquaredErrors() const override;
+  GLuint GetTexture(size_t slot) override;
+
+ private:
+  struct Vertex {
+    GLfloat x, y;
+    GLfloat r, g, b, a;
+    GLint layer;
+  };
+  static const size_t kRegions = 3;
+
+  struct Readback {
+    GLuint buffer = 0;
+    GLsync fence = nullptr;
+    bool mapped = false;
+  };
+
+  void SetupBuffers_();
+  void SetupLayeredBuffers_();
+  bool SetupProgram_();
+  bool SetupErrorPrograms_();
+  void ReserveVertices_(size_t count);
+  void DrawImmediate_(const Chromosome &chromosome);
+  void DrawBatched_(const Chromosome *chromosomes, size_t count, size_t first_layer);
+  void ClearLayers_(size_t first, size_t count);
+
+  bool layered_;
+  std::vector<GLuint> buffers_;
+  std::vector<GLuint> textures_;
+  std::vector<GLubyte> pixels_;
+  // layered mode: all slots in one array texture, textures_ holds views of its layers created on demand
+  GLuint array_texture_ = 0;
+
+  // batched path, program_ stays 0 when immediate mode is used
+  GLuint program_ = 0;
+  GLuint vertex_array_ = 0;
+  GLuint vertex_buffer_ = 0;
+  size_t region_vertices_ = 0;
+  size_t region_ = 0;
+  Vertex *mapped_ = nullptr;
+  GLsync fences_[kRegions] = {};
+  std::vector<Vertex> vertices_;
+
+  // ring of pixel pack buffers for asynchronous reads, empty without fence syncs
+  std::vector<Readback> readbacks_;
+  size_t begun_reads_ = 0;
+  size_t ended_reads_ = 0;
+
+  // squared errors on the GPU, error_program_ stays 0 without compute shaders
+  GLuint target_texture_ = 0;
+  GLuint error_program_ = 0;
+  GLuint sum_program_ = 0;
+  GLuint partial_buffer_ = 0;
+  GLuint error_buffer_ = 0;
+  size_t error_capacity_ = 0;
+  // low and high words of the errors read back, reused across calls
+  std::vector<GLuint> sums_;
+  bool skip_alpha_ = false;
+};
+
+/**
+ * @brief Pure CPU half-space rasterizer with source-over blending into host memory
+ *
+ * Coverage follows the GL rasterization rules: vertices are snapped to 1/256 of a pixel, a pixel is
+ * covered when its centre is inside the triangle and pixels on shared edges are assigned by the top-left
+ * rule. Blending is done in 8 bits as dst = src * a / 255 + dst * (255 - a) / 255, each term rounded, with
+ * the alpha channel blended by the same factors as glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) does.
+ *
+ * Tolerance against GL (measured on Mesa llvmpipe): single triangles are bit exact, composited genomes
+ * differ by at most one unit per channel on well under 1% of the pixels. Pixels whose centre lies within
+ * about 1/100 of a pixel from an edge may be covered differently, since GL implementations evaluate edges
+ * with their own precision, so a handful of such pixels per image can differ by a full blend step.
+ *
+ * With a thread pool, images are split into kTileWidth x kTileHeight tiles. Triangles are binned into the
+ * tiles their bounding box touches and every tile is composited in genome order on its own worker, so
+ * the result is identical to the single threaded draw. Tiles are wide because the span of every row is
+ * solved once per tile it crosses: 32x32 tiles cost about 4x the single threaded work on 1024x1024
+ * targets, 256x16 tiles about 1.3x. Draws issued from inside a pool task (e.g. when
+ * whole individuals are already rendered in parallel) stay on the calling thread.
+ *
+ * A slot passed to CacheSlot gets a CompositeCache, and DrawRegion calls copying from it redraw only the
+ * triangles around the changed ones.
+ *
+ * When a GL context is loaded the slots are mirrored into textures on demand so the GUI can show them,
+ * otherwise the backend never touches GL. Drawing and copying only mark a slot as changed and GetTexture
+ * uploads it, so worker threads without the context never make GL calls.
+ */
+class SoftwareRenderBackend : public RenderBackend {
+ public:
+  static const int kTileWidth = 256;
+  static const int kTileHeight = 16;
+
+  SoftwareRenderBackend(int width, int height, size_t slots, ThreadPool *pool = nullptr);
+  ~SoftwareRenderBackend() override;
+
+  void Draw(const Chromosome &chromosome, size_t slot) override;
+  bool DrawRegion(const Chromosome &chromosome, size_t from, size_t slot, const Rect &rect) override;
+  bool RedrawRegion(const Chromosome &chromosome, size_t from, size_t slot, const Rect &rect) override;
+  bool CacheSlot(const Chromosome &chromosome, size_t slot) override;
+  const GLubyte *GetPixels(size_t slot) override;
+  void ReadPixels(size_t slot, GLubyte *pixels) override;
+  bool IsThreadSafe() const override;
+  void CopySlot(size_t from, size_t to) override;
+  void CopyRegion(size_t from, size_t to, const Rect &rect) override;
+  GLuint GetTexture(size_t slot) override;
+
+ private:
+  void DrawTiled_(const Chromosome &chromosome, GLubyte *pixels);
+  void Recomposite_(const Chromosome &chromosome, size_t from, size_t slot, const Rect &rect);
+  void UploadTexture_(size_t slot);
+  void Overwrite_(size_t slot);
+
+  ThreadPool *pool_;
+  int tiles_x_;
+  int tiles_y_;
+  std::vector<std::vector<uint32_t>> bins_;
+  std::vector<RasterTriangle> setups_;
+  std::vector<std::vector<GLubyte>> pixels_;
+  std::vector<GLuint> textures_;
+  std::vector<uint8_t> dirty_;
+  bool mirror_textures_;
+  // prefix and suffix composites of the chromosome in cache_slot_, dropped once that slot is drawn over
+  CompositeCache cache_;
+  std::atomic<size_t> cache_slot_{Chromosome::kNoSlot};
+};
+
+/**
+ * @brief Create a backend of the given type with slots slots of width x height pixels. The GL backends need
+ * a current context
+ *
+ * @param type
+ * @param width
+ * @param height
+ * @param slots
+ * @param pool spreads the software backend's draws over its threads, may be nullptr
+ * @return RenderBackend* owned by the caller
+ */
+RenderBackend *CreateRenderBackend(RenderBackendType type, int width, int height, size_t slots, ThreadPool *pool);
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief A fresh nonzero seed from std::random_device
+ */
+uint64_t RandomSeed();
+
+/**
+ * @brief xoshiro256++ pseudo random generator
+ *
+ * Generators are cheap to create and are keyed by a seed and a stream number, so work items can each get
+ * their own stream (e.g. one per child of a generation) and produce the same numbers no matter which
+ * thread runs them or in which order.
+ */
+class Rng {
+ public:
+  /**
+   * @brief Seed the state from seed and stream through splitmix64
+   *
+   * @param seed
+   * @param stream counter selecting an independent sequence for the same seed
+   */
+  explicit Rng(uint64_t seed = 0, uint64_t stream = 0);
+
+  uint64_t operator()() {
+    uint64_t result = Rotl_(s_[0] + s_[3], 23) + s_[0];
+    uint64_t t = s_[1] << 17;
+    s_[2] ^= s_[0];
+    s_[3] ^= s_[1];
+    s_[1] ^= s_[2];
+    s_[0] ^= s_[3];
+    s_[2] ^= t;
+    s_[3] = Rotl_(s_[3], 45);
+    return result;
+  }
+
+  /**
+   * @brief Uniform integer in [0, n), by multiplying instead of the slower and no less biased modulo
+   */
+  uint32_t Below(uint32_t n) { return static_cast<uint32_t>(((*this)() >> 32) * n >> 32); }
+
+  /**
+   * @brief Uniform float in [from, to)
+   */
+  float Float(float from = 0, float to = 1) {
+    return from + (to - from) * (static_cast<float>((*this)() >> 40) * (1.0f / 16777216.0f));
+  }
+
+  /**
+   * @brief Fill count floats uniform in [from, to)
+   */
+  void Fill(float *values, size_t count, float from = 0, float to = 1);
+
+ private:
+  static uint64_t Rotl_(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+  uint64_t s_[4];
+};
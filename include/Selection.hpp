@@ -1,6 +1,8 @@
 #pragma once
 
 #include <Chromosome.hpp>
+#include <Rng.hpp>
+#include <cstddef>
 #include <vector>
 
 enum SelectionType {
@@ -16,32 +18,51 @@ class SelectionStrategy {
  public:
   SelectionStrategy() = default;
   SelectionStrategy(const float cleansing_rate);
-  virtual std::vector<Chromosome> operator()(const std::vector<Chromosome> &) = 0;
+  /**
+   * @brief Pick the parents of the next generation
+   *
+   * @param parents filled with indices into the given chromosomes, which are read in place and never copied.
+   * Its capacity is reused, so a caller keeping it across generations does not allocate
+   */
+  virtual void operator()(const std::vector<Chromosome> &, Rng &rng, std::vector<size_t> &parents) = 0;
+  virtual ~SelectionStrategy() = default;
 
  protected:
+  // running sums of the fitness values, reused across calls
+  void AccumulateFitness_(const std::vector<Chromosome> &chromosomes);
+  // parents to keep out of size chromosomes, at least one so breeding always has a parent to draw
+  size_t Keep_(size_t size) const;
+
   float cleansing_rate_ = 1.0f;
+  std::vector<double> acc_fitness_;
 };
 
 class FitnessPropotionateSelection : public SelectionStrategy {
  public:
   using SelectionStrategy::SelectionStrategy;
-  std::vector<Chromosome> operator()(const std::vector<Chromosome> &) override;
+  void operator()(const std::vector<Chromosome> &, Rng &rng, std::vector<size_t> &parents) override;
 };
 
 class StochasticUniversalSampling : public SelectionStrategy {
  public:
   using SelectionStrategy::SelectionStrategy;
-  std::vector<Chromosome> operator()(const std::vector<Chromosome> &) override;
+  void operator()(const std::vector<Chromosome> &, Rng &rng, std::vector<size_t> &parents) override;
 };
 
 class TournamentSelection : public SelectionStrategy {
  public:
   using SelectionStrategy::SelectionStrategy;
-  std::vector<Chromosome> operator()(const std::vector<Chromosome> &) override;
+  void operator()(const std::vector<Chromosome> &, Rng &rng, std::vector<size_t> &parents) override;
+  /**
+   * @brief Run a single tournament
+   *
+   * @return index of the fittest of a few chromosomes drawn with replacement
+   */
+  size_t Pick(const std::vector<Chromosome> &chromosomes, Rng &rng) const;
 };
 
 class TruncationSelection : public SelectionStrategy {
  public:
   using SelectionStrategy::SelectionStrategy;
-  std::vector<Chromosome> operator()(const std::vector<Chromosome> &) override;
+  void operator()(const std::vector<Chromosome> &, Rng &rng, std::vector<size_t> &parents) override;
 };
\ No newline at end of file
@@ -1,53 +1,197 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <utility>
 #include <vector>
 #include <Utils.hpp>
+#include <Engine.hpp>
 #include <Selection.hpp>
 #include <Crossover.hpp>
+#include <PopulationStore.hpp>
+#include <RenderBackend.hpp>
+#include <ThreadPool.hpp>
 
-struct IterationResult {
-  size_t iteration;
-  GLuint texture;
-  float best_fitness;
-  float worst_fitness;
-  float mean_fitness;
+struct SolverOptions {
+  EngineType engine = GENETIC;
+  // for annealing an iteration tries population_size candidates, as many as a generation renders, the
+  // evolution strategy breeds population_size children per generation
+  size_t population_size = 20;
+  size_t genome_size = 100;
+  float cleansing_rate = 0.7f;
+  CrossoverType crossover_type = NONE;
+  SelectionType selection_type = TRUNCATION_SELECTION;
+  RenderBackendType render_backend = OPENGL;
+  // leave the alpha channel out of the squared error
+  bool skip_alpha = false;
+  // worker threads for rendering and scoring including the caller, 0 means one per hardware thread
+  size_t threads = 0;
+  // keep prefix and suffix composites of the best individual so its mutated copies redraw only a few triangles
+  bool composite_cache = false;
+  // start scoring against the target downsampled this many times by 2 and move one level finer whenever the
+  // best fitness has not improved for stall_generations iterations
+  size_t coarse_levels = 0;
+  size_t stall_generations = 50;
+  // score every child on a 4x downsampled proxy first and render at full resolution only this top fraction,
+  // plus those the proxy cannot tell apart from it with the given chance of wrongly rejecting a child.
+  // 0 turns racing off
+  float racing_fraction = 0;
+  float racing_rejection_budget = 0.05f;
+  // with truncation selection, stop scoring a child once its partial squared error already ranks it below the
+  // survivors. Its fitness is then computed from that partial sum, an upper bound that still ranks it below them
+  bool early_abort = false;
+  // reuse the fitness and image of children whose genome equals one of the previous generation or an earlier
+  // sibling instead of rendering them again
+  bool fitness_memo = false;
+  // runs with the same seed and options breed the same genomes on any number of threads, 0 picks a seed
+  uint64_t seed = 0;
+  // island model: evolve this many populations of population_size side by side, each on its own thread with
+  // the software backend, and every migration_interval generations send copies of the migrants fittest
+  // individuals of each island to the next one on the topology. 1 runs a single population
+  size_t islands = 1;
+  size_t migration_interval = 10;
+  size_t migrants = 2;
+  MigrationTopology migration_topology = RING;
+  // annealing: the schedule cools from temperature, in units of the mean squared error, to zero over
+  // schedule_length candidates. The Geman & Geman schedules use their constant instead and never reach zero
+  ScheduleType schedule = GEOMETRIC;
+  size_t schedule_length = 100000;
+  float temperature = 1.0f;
 };
 
-class Solver {
+/**
+ * @brief Genetic algorithm engine
+ */
+class Solver : public Engine {
  public:
   Solver() = default;
-  Solver(Image image, size_t pop_size, size_t genome_size, float cleansing_rate, CrossoverType crossover_type,
-         SelectionType selection_type);
-  IterationResult Iteration();
-  void Cleanup();
+  Solver(Image image, const SolverOptions &options);
+  IterationResult Iteration() override;
+  void Cleanup() override;
 
-  const std::vector<GLuint> &GetTextures() const;
-  GLuint GetBestTexture() const;
+  GLuint GetBestTexture() const override;
+
+  /**
+   * @brief Fitness of the image in GetBestTexture(), the best one found at the current pyramid level
+   */
+  float GetBestFitness() const;
+
+  /**
+   * @brief Move to the next finer pyramid level once the current one has stalled. Recreates the backend, so
+   * this has to run on the thread of the GL context
+   */
+  void RefineLevel();
+
+  /**
+   * @brief Breed and score one generation without touching GL, result.texture is left unset. Islands run
+   * this on worker threads when the backend is thread safe
+   */
+  IterationResult Evolve();
+
+  /**
+   * @brief Copy the count fittest individuals of the current generation, fittest first
+   *
+   * @param count
+   * @param migrants resized to count, its chromosomes are reused
+   */
+  void Emigrate(size_t count, std::vector<Chromosome> &migrants);
+
+  /**
+   * @brief Replace the worst individuals of the current generation with migrants from another population
+   * and score them here
+   *
+   * @param migrants
+   */
+  void Immigrate(const std::vector<Chromosome> &migrants);
 
  private:
-  // parameters
+  // parameters, image_ is the pyramid level currently scored against
   Image image_;
+  std::vector<Image> pyramid_;
+  size_t level_ = 0;
+  size_t stall_generations_;
+  size_t stalled_ = 0;
+  float level_best_fitness_ = 0;
   size_t population_size_;
   size_t chromosome_size_;
+  bool skip_alpha_ = false;
+  bool composite_cache_ = false;
   bool initialized_ = false;
   size_t iteration_ = 0;
+  uint64_t seed_;
 
   // stuff related to genetic algorithm
-  void CalcFitness_();
-  std::vector<Chromosome> population_;
+  struct Cutoff;
+  void EvaluatePopulation_();
+  void EvaluateIndividuals_(const std::vector<size_t> &indices);
+  void EvaluateChromosome_(size_t i, size_t worker);
+  uint64_t ScanSquaredError_(const GLubyte *pixels, Cutoff *cutoff, uint64_t *bands, bool &complete) const;
+  void RecallKnown_();
+  void RememberKnown_();
+  void RaceProxies_(const std::vector<size_t> &candidates);
+  void CalibrateProxies_(const std::vector<size_t> &candidates, const std::vector<size_t> &promoted);
+  void CacheElite_();
+  PopulationStore population_;
   CrossoverStrategy *Crossover_;
   SelectionStrategy *Selection_;
   float best_fitness_ = 0;
 
+  // scratch reused by every generation, so breeding and scoring one does not allocate: the selected parents,
+  // the children to score and those promoted by racing, GPU squared errors and a fitness order for migration
+  std::vector<size_t> parents_;
+  std::vector<size_t> pending_;
+  std::vector<size_t> promoted_;
+  std::vector<uint64_t> errors_;
+  std::vector<size_t> order_;
+
   // Selection functions
   std::vector<Chromosome> UniformSelection_(const std::vector<Chromosome> &chromosomes);
 
-  // OpenGL stuff
-  void SetupBuffers_();
-  size_t buffer_size_;
-  std::vector<GLuint> buffers_;
-  std::vector<GLuint> textures_;
-  std::unique_ptr<GLubyte[]> cur_pixels_;
-  std::unique_ptr<GLubyte[]> img_pixels_;
+  // Rendering stuff, two slots per individual plus the best of all time. Generations alternate between
+  // the two halves so children can be redrawn incrementally from their parents' images
+  void CreateBackend_();
+  void SetLevel_(size_t level);
+  ThreadPool *Pool_;
+  RenderBackendType render_backend_;
+  RenderBackend *Backend_;
+  size_t slot_base_ = 0;
+  size_t best_slot_;
+  size_t pixel_count_;
+
+  // racing: one proxy slot per child, log(exact / proxy fitness) tracked as an exponentially weighted
+  // mean and variance over the children that made it to full resolution
+  float racing_fraction_ = 0;
+  double racing_z_ = 0;
+  RenderBackend *Proxy_ = nullptr;
+  size_t proxy_level_ = 0;
+  std::vector<double> proxy_fitness_;
+  size_t racing_samples_ = 0;
+  double racing_mean_ = 0;
+  double racing_variance_ = 0;
+
+  // early abort: number of truncation survivors, 0 when off, and the order rows of kScanBand are scanned in,
+  // worst first as measured on the best child of the last generation
+  size_t survivors_ = 0;
+  std::vector<size_t> band_order_;
+  Cutoff *Cutoff_ = nullptr;
+  // per band errors of the child each worker scans
+  std::vector<std::vector<uint64_t>> bands_;
+  // children whose fitness is a bound or a prediction rather than exact
+  std::vector<uint8_t> aborted_;
+
+  // fitness memo: exactly scored genomes of the last generation sorted by hash, their images stay in their
+  // slots for one more generation. siblings_ holds the hashes of the children to score and duplicates_ pairs
+  // children with an earlier sibling of the same genome. Sorted vectors rather than hash maps, so a
+  // generation reuses their capacity instead of allocating nodes
+  struct Known {
+    uint64_t hash;
+    size_t slot;
+    uint64_t squared_error;
+    float fitness;
+  };
+  // first entry whose hash is not below hash
+  std::vector<Known>::iterator FindKnown_(uint64_t hash);
+  bool fitness_memo_ = false;
+  std::vector<Known> known_;
+  std::vector<std::pair<uint64_t, size_t>> siblings_;
+  std::vector<std::pair<size_t, size_t>> duplicates_;
 };
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+#include <Chromosome.hpp>
+#include <Crossover.hpp>
+#include <Engine.hpp>
+#include <Rasterizer.hpp>
+#include <RenderBackend.hpp>
+#include <Rng.hpp>
+#include <Selection.hpp>
+#include <Solver.hpp>
+#include <ThreadPool.hpp>
+#include <Utils.hpp>
+
+/**
+ * @brief Steady-state genetic algorithm: one child per step, which replaces the worst individual if it is
+ * better
+ *
+ * Parents are picked by tournament, crossed over and the child mutated, so with no crossover a child is
+ * redrawn only where its mutation changed the parent's image. Individuals keep their slots and the child is
+ * drawn into the one spare slot, so a replacement swaps slots instead of copying pixels. The individuals
+ * are kept in a heap with the largest squared error on top, so the worst one is found in O(log n).
+ *
+ * An iteration runs population_size steps, as many children as a generation of the generational solver
+ * breeds, and reports the best, mean and worst fitness of the population.
+ */
+class SteadyStateSolver : public Engine {
+ public:
+  SteadyStateSolver(Image image, const SolverOptions &options);
+  IterationResult Iteration() override;
+  void Cleanup() override;
+  GLuint GetBestTexture() const override;
+
+ private:
+  // one child bred, scored and either inserted or dropped
+  void Step_();
+  bool HeapLess_(size_t a, size_t b) const;
+  uint64_t Evaluate_(Chromosome &chromosome, size_t slot);
+
+  Image image_;
+  size_t pixel_count_;
+  size_t population_size_;
+  bool skip_alpha_;
+  bool composite_cache_;
+  bool initialized_ = false;
+  size_t iteration_ = 0;
+
+  Rng rng_;
+  std::vector<Chromosome> population_;
+  // indices into population_, a max heap on the squared error
+  std::vector<size_t> heap_;
+  size_t best_ = 0;
+  Chromosome child_;
+  size_t spare_slot_;
+  size_t cached_slot_ = Chromosome::kNoSlot;
+
+  TournamentSelection tournament_;
+  CrossoverStrategy *Crossover_;
+  ThreadPool *Pool_;
+  RenderBackend *Backend_;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Persistent set of worker threads running index based parallel loops
+ *
+ * The calling thread takes part in every loop as worker 0, so a pool of N threads starts N - 1 workers.
+ * Loops started from inside a running task are executed inline by the current thread, which keeps nested
+ * parallelism (e.g. a tiled draw inside a per-individual task) from deadlocking or oversubscribing.
+ */
+class ThreadPool {
+ public:
+  /**
+   * @brief Start the workers
+   *
+   * @param threads total number of threads including the caller, 0 means one per hardware thread
+   */
+  ThreadPool(size_t threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  size_t GetThreadCount() const;
+
+  /**
+   * @brief Call task(index, worker) for every index in [0, count) and wait for all of them
+   *
+   * @param count number of indices
+   * @param task gets the index and the id of the thread running it, in [0, GetThreadCount())
+   */
+  void ParallelFor(size_t count, const std::function<void(size_t, size_t)> &task);
+
+  /**
+   * @brief Whether the current thread is running a task of some pool
+   */
+  static bool InTask();
+
+ private:
+  void WorkerLoop_(size_t worker);
+  void RunTasks_(size_t worker);
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::mutex submit_mutex_;
+  std::condition_variable start_;
+  std::condition_variable finish_;
+  bool stop_ = false;
+
+  // current loop, replaced only when no worker is inside it
+  const std::function<void(size_t, size_t)> *task_ = nullptr;
+  size_t count_ = 0;
+  size_t generation_ = 0;
+  size_t active_ = 0;
+  std::atomic<size_t> next_{0};
+  std::atomic<size_t> done_{0};
+};
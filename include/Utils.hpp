@@ -5,15 +5,8 @@
 
 #include <cstdio>
 #include <filesystem>
-
-/**
- * @brief Generate a random float
- *
- * @param from lower bound
- * @param to upper bound
- * @return float
- */
-float rand_float(float from = 0, float to = 1);
+#include <initializer_list>
+#include <vector>
 
 /**
  * @brief Clamp a given value between boundariess
@@ -29,6 +22,42 @@ struct Image {
   GLuint texture = -1;
   int width = 0;
   int height = 0;
+  std::vector<GLubyte> pixels;
 };
 
+/**
+ * @brief Load an image into host memory only, does not need a GL context
+ *
+ * @param path
+ * @param image receives RGBA8 pixels, texture is left untouched
+ * @return true on success
+ */
+bool LoadImageFromFile(std::filesystem::path path, Image &image);
+
 bool LoadTextureFromFile(std::filesystem::path path, Image &texture);
+
+/**
+ * @brief Downsample an image into a mip pyramid on the host, stops early once a side would reach one pixel
+ *
+ * @param image
+ * @param levels number of levels including the image itself at level 0, level k is 2^k times smaller
+ * @return std::vector<Image> without textures
+ */
+std::vector<Image> BuildPyramid(const Image &image, size_t levels);
+
+/**
+ * @brief Compile a GLSL shader, logging the info log on failure
+ *
+ * @param type e.g. GL_VERTEX_SHADER
+ * @param source
+ * @return GLuint shader name, 0 on failure
+ */
+GLuint CompileShader(GLenum type, const char *source);
+
+/**
+ * @brief Link compiled shaders into a program, logging the info log on failure
+ *
+ * @param shaders
+ * @return GLuint program name, 0 on failure
+ */
+GLuint LinkProgram(std::initializer_list<GLuint> shaders);
@@ -0,0 +1,165 @@
+#include <Annealer.hpp>
+#include <Fitness.hpp>
+#include <plog/Log.h>
+#include <algorithm>
+#include <cmath>
+
+const char *schedule_names[9] = {"Geman & Geman, c = 1",
+                                 "Geman & Geman, c = 50",
+                                 "Geman & Geman, c = 195075",
+                                 "Linear",
+                                 "Staircase",
+                                 "Sigmoid",
+                                 "Geometric",
+                                 "Linear with reheat",
+                                 "Cosine"};
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+// the staircase drops this many times, the reheating schedule heats up again this many times
+const int kStairs = 10;
+const int kReheats = 4;
+// the geometric schedule ends at this fraction of the start temperature
+const double kGeometricEnd = 1e-3;
+
+}  // namespace
+
+Annealer::Annealer(Image image, const SolverOptions &options)
+    : image_(std::move(image)),
+      skip_alpha_(options.skip_alpha),
+      steps_per_iteration_(std::max<size_t>(1, options.population_size)),
+      schedule_(options.schedule),
+      schedule_length_(std::max<size_t>(1, options.schedule_length)),
+      temperature_(options.temperature),
+      initialized_(true),
+      rng_(options.seed != 0 ? options.seed : RandomSeed()) {
+  Pool_ = new ThreadPool(options.threads);
+  PLOGI << "Annealer " << this << " uses " << Pool_->GetThreadCount() << " threads, schedule \""
+        << schedule_names[schedule_] << "\"";
+  pixel_count_ = static_cast<size_t>(image_.width) * image_.height;
+  Backend_ = CreateRenderBackend(options.render_backend, image_.width, image_.height, kBestSlot + 1, Pool_);
+  Backend_->SetTarget(image_.pixels.data(), skip_alpha_);
+
+  current_ = Chromosome(options.genome_size, rng_);
+  current_.Draw(*Backend_, kCurrentSlot);
+  squared_error_ = ScoreSlot_(kCurrentSlot);
+  best_squared_error_ = squared_error_;
+  current_.SetRendered(kCurrentSlot, squared_error_);
+  Backend_->CopySlot(kCurrentSlot, kCandidateSlot);
+  Backend_->CopySlot(kCurrentSlot, kBestSlot);
+}
+
+IterationResult Annealer::Iteration() {
+  IterationResult result = {0};
+  result.iteration = ++iteration_;
+  result.worst_fitness = INFINITY;
+  for (size_t k = 0; k < steps_per_iteration_; ++k) {
+    float fitness = SquaredErrorFitness(Step_(), pixel_count_, skip_alpha_);
+    result.worst_fitness = std::min(result.worst_fitness, fitness);
+  }
+  result.best_fitness = SquaredErrorFitness(best_squared_error_, pixel_count_, skip_alpha_);
+  result.mean_fitness = SquaredErrorFitness(squared_error_, pixel_count_, skip_alpha_);
+  result.texture = Backend_->GetTexture(kBestSlot);
+  return result;
+}
+
+void Annealer::Cleanup() {
+  if (initialized_) {
+    PLOGI << "Cleaning up object " << this;
+    delete Backend_;
+    delete Pool_;
+  } else {
+    PLOGI << "Nothing to clean up";
+  }
+}
+
+GLuint Annealer::GetBestTexture() const {
+  return Backend_->GetTexture(kBestSlot);
+}
+
+uint64_t Annealer::Step_() {
+  current_.Mutate(rng_);
+  Rect rect = current_.GetDirtyRect(image_.width, image_.height);
+
+  uint64_t se;
+  bool partial = Backend_->DrawRegion(current_, kCandidateSlot, kCandidateSlot, rect);
+  if (partial) {
+    se = squared_error_ - CalcSquaredError(image_, Backend_->GetPixels(kCurrentSlot), rect, skip_alpha_) +
+         CalcSquaredError(image_, Backend_->GetPixels(kCandidateSlot), rect, skip_alpha_);
+  } else {
+    current_.Draw(*Backend_, kCandidateSlot);
+    se = ScoreSlot_(kCandidateSlot);
+  }
+
+  double samples = static_cast<double>(pixel_count_ * (skip_alpha_ ? 3 : 4));
+  double delta = (static_cast<double>(se) - static_cast<double>(squared_error_)) / samples;
+  double temperature = Temperature_();
+  ++step_;
+  if (delta <= 0 || (temperature > 0 && rng_.Float() < std::exp(-delta / temperature))) {
+    if (partial) {
+      Backend_->CopyRegion(kCandidateSlot, kCurrentSlot, rect);
+      best_dirty_ = best_dirty_.Union(rect);
+    } else {
+      Backend_->CopySlot(kCandidateSlot, kCurrentSlot);
+      best_dirty_ = {0, 0, image_.width, image_.height};
+    }
+    squared_error_ = se;
+    current_.SetRendered(kCurrentSlot, se);
+    if (se < best_squared_error_) {
+      // a hotter step may move away from it again before the iteration ends
+      Backend_->CopyRegion(kCurrentSlot, kBestSlot, best_dirty_);
+      best_dirty_ = Rect();
+      best_squared_error_ = se;
+    }
+  } else {
+    current_.Undo();
+    if (partial) {
+      Backend_->CopyRegion(kCurrentSlot, kCandidateSlot, rect);
+    }
+  }
+  return se;
+}
+
+double Annealer::Temperature_() const {
+  double x = std::min(1.0, static_cast<double>(step_) / schedule_length_);
+  switch (schedule_) {
+    case GEMAN_1: {
+      return 1.0 / std::log(step_ + 2.0);
+    }
+    case GEMAN_50: {
+      return 50.0 / std::log(step_ + 2.0);
+    }
+    case GEMAN_195075: {
+      return 195075.0 / std::log(step_ + 2.0);
+    }
+    case LINEAR: {
+      return temperature_ * (1 - x);
+    }
+    case STAIRCASE: {
+      return temperature_ * (1 - std::floor(x * kStairs) / kStairs);
+    }
+    case SIGMOID: {
+      return x < 1 ? temperature_ / (1 + std::exp(12 * (x - 0.5))) : 0;
+    }
+    case GEOMETRIC: {
+      return x < 1 ? temperature_ * std::pow(kGeometricEnd, x) : 0;
+    }
+    case LINEAR_REHEAT: {
+      double phase = x * kReheats - std::floor(x * kReheats);
+      return temperature_ * (1 - x) * (1 - phase);
+    }
+    case COSINE: {
+      return temperature_ * 0.5 * (1 + std::cos(kPi * x));
+    }
+  }
+  return 0;
+}
+
+uint64_t Annealer::ScoreSlot_(size_t slot) {
+  uint64_t se;
+  if (!Backend_->ComputeSquaredErrors(slot, 1, &se)) {
+    se = CalcSquaredError(image_, Backend_->GetPixels(slot), {0, 0, image_.width, image_.height}, skip_alpha_);
+  }
+  return se;
+}
@@ -32,11 +32,26 @@ void Application::Run() {
   ImGui::FileBrowser file_dialog;
   std::filesystem::path input_path;
   std::string filename_str = "";
+  int engine = EngineType::GENETIC;
+  int schedule = ScheduleType::GEOMETRIC;
+  float temperature = 1.0f;
   int population_size = 20;
   int genome_size = 100;
   float cleansing_rate = 0.7f;
   int crossover_type = CrossoverType::NONE;
   int selection_type = SelectionType::TRUNCATION_SELECTION;
+  int render_backend = RenderBackendType::OPENGL;
+  bool skip_alpha = false;
+  bool composite_cache = false;
+  int coarse_levels = 0;
+  float racing_fraction = 0.0f;
+  bool early_abort = false;
+  bool fitness_memo = false;
+  int islands = 1;
+  int migration_interval = 10;
+  int migrants = 2;
+  int migration_topology = MigrationTopology::RING;
+  int threads = 0;
   GLuint best_texture = -1;
 
   bool flag = true;
@@ -60,24 +75,91 @@ void Application::Run() {
       ImGui::SameLine();
       ImGui::Text("Selected file: %s", filename_str.empty() ? "None" : filename_str.c_str());
 
+      ImGui::Combo("Engine", &engine, engine_names, IM_ARRAYSIZE(engine_names));
+
+      if (engine == ANNEALING) {
+        ImGui::Combo("Cooling schedule", &schedule, schedule_names, IM_ARRAYSIZE(schedule_names));
+
+        ImGui::DragFloat("Temperature", &temperature, 0.01f, 0.0f, 100.0f, "%6.2f", ImGuiSliderFlags_AlwaysClamp);
+      }
+
       ImGui::DragInt("Population size", &population_size, 1.0f, 2, 50, "%d", ImGuiSliderFlags_AlwaysClamp);
 
       ImGui::DragInt("Genome size", &genome_size, 1.0f, 1, 10000, "%d", ImGuiSliderFlags_AlwaysClamp);
 
-      ImGui::DragFloat("Cleansing rate", &cleansing_rate, 0.01f, 0.0f, 1.0f, "%4.2f", ImGuiSliderFlags_AlwaysClamp);
+      // the other engines ignore the options they do not show
+      if (engine == GENETIC) {
+        ImGui::DragFloat("Cleansing rate", &cleansing_rate, 0.01f, 0.0f, 1.0f, "%4.2f", ImGuiSliderFlags_AlwaysClamp);
+      }
+
+      if (engine == GENETIC || engine == STEADY_STATE) {
+        ImGui::Combo("Crossover type", &crossover_type, crossover_type_names, IM_ARRAYSIZE(crossover_type_names));
+      }
+
+      if (engine == GENETIC) {
+        ImGui::Combo("Selection type", &selection_type, selection_type_names, IM_ARRAYSIZE(selection_type_names));
+      }
+
+      ImGui::Combo("Render backend", &render_backend, render_backend_names, IM_ARRAYSIZE(render_backend_names));
+
+      ImGui::Checkbox("Ignore alpha channel", &skip_alpha);
 
-      ImGui::Combo("Crossover type", &crossover_type, crossover_type_names, IM_ARRAYSIZE(crossover_type_names));
+      ImGui::DragInt("Threads (0 = all)", &threads, 1.0f, 0, 256, "%d", ImGuiSliderFlags_AlwaysClamp);
 
-      ImGui::Combo("Selection type", &selection_type, selection_type_names, IM_ARRAYSIZE(selection_type_names));
+      if (engine != ANNEALING) {
+        ImGui::Checkbox("Cache best individual", &composite_cache);
+      }
+
+      if (engine == GENETIC) {
+        ImGui::DragInt("Coarse levels", &coarse_levels, 1.0f, 0, 4, "%d", ImGuiSliderFlags_AlwaysClamp);
+
+        ImGui::DragFloat("Racing fraction", &racing_fraction, 0.01f, 0.0f, 1.0f, "%4.2f", ImGuiSliderFlags_AlwaysClamp);
+
+        ImGui::Checkbox("Abort hopeless children early", &early_abort);
+
+        ImGui::Checkbox("Reuse known genomes", &fitness_memo);
+
+        ImGui::DragInt("Islands", &islands, 1.0f, 1, 64, "%d", ImGuiSliderFlags_AlwaysClamp);
+
+        if (islands > 1) {
+          ImGui::DragInt("Migration interval", &migration_interval, 1.0f, 1, 1000, "%d", ImGuiSliderFlags_AlwaysClamp);
+
+          ImGui::DragInt("Migrants", &migrants, 1.0f, 0, 50, "%d", ImGuiSliderFlags_AlwaysClamp);
+
+          ImGui::Combo("Migration topology", &migration_topology, migration_topology_names,
+                       IM_ARRAYSIZE(migration_topology_names));
+        }
+      }
 
       if (ImGui::Button("START")) {
         if (input_path.empty()) {
           ImGui::OpenPopup("Select a file first");
         } else {
-          solver_.Cleanup();
-          solver_ = Solver(image_, population_size, genome_size, cleansing_rate, CrossoverType(crossover_type),
-                           SelectionType(selection_type));
-          best_texture = solver_.GetBestTexture();
+          if (engine_ != nullptr) {
+            engine_->Cleanup();
+          }
+          SolverOptions options;
+          options.engine = EngineType(engine);
+          options.schedule = ScheduleType(schedule);
+          options.temperature = temperature;
+          options.population_size = population_size;
+          options.genome_size = genome_size;
+          options.cleansing_rate = cleansing_rate;
+          options.crossover_type = CrossoverType(crossover_type);
+          options.selection_type = SelectionType(selection_type);
+          options.render_backend = RenderBackendType(render_backend);
+          options.skip_alpha = skip_alpha;
+          options.threads = threads;
+          options.composite_cache = composite_cache;
+          options.coarse_levels = coarse_levels;
+          options.racing_fraction = racing_fraction;
+          options.early_abort = early_abort;
+          options.fitness_memo = fitness_memo;
+          options.islands = islands;
+          options.migration_interval = migration_interval;
+          options.migrants = migrants;
+          options.migration_topology = MigrationTopology(migration_topology);
+          engine_.reset(CreateEngine(image_, options));
           Start();
         }
       }
@@ -124,7 +206,9 @@ void Application::Run() {
     }
 
     if (running_) {
-      IterationResult res = solver_.Iteration();
+      IterationResult res = engine_->Iteration();
+      // the solver recreates its slots when it moves to a finer level, so ask for the texture every frame
+      best_texture = engine_->GetBestTexture();
 
       ImGui::Begin("Best of all time", NULL, ImGuiWindowFlags_AlwaysAutoResize);
       ImGui::Image((void *)(intptr_t)best_texture, ImVec2(image_.width, image_.height));
@@ -134,6 +218,7 @@ void Application::Run() {
       ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate,
                   ImGui::GetIO().Framerate);
       ImGui::Text("Current iteration: %lu", res.iteration);
+      ImGui::Text("Resolution: 1/%d", 1 << res.level);
       ImGui::Text("Mean MSE: %.2f", res.mean_fitness);
       ImGui::Text("Best MSE: %.2f", res.best_fitness);
       ImGui::Text("Worst MSE: %.2f", res.worst_fitness);
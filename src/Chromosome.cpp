@@ -1,65 +1,156 @@
 #include <Chromosome.hpp>
-#include <Utils.hpp>
+#include <Rasterizer.hpp>
+#include <RenderBackend.hpp>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
-Chromosome::Chromosome(const size_t size) : triangles_(size) {
-  for (auto &tr : triangles_) {
-    tr = {{{rand_float(-1, 1), rand_float(-1, 1)},
-           {rand_float(-1, 1), rand_float(-1, 1)},
-           {rand_float(-1, 1), rand_float(-1, 1)}},
-          {rand_float(), rand_float(), rand_float(), rand_float()}};
+namespace {
+
+uint64_t Mix(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+uint64_t HashTriangle(size_t idx, const Triangle &tr) {
+  uint64_t words[sizeof(Triangle) / sizeof(uint64_t)];
+  static_assert(sizeof(Triangle) % sizeof(uint64_t) == 0, "triangles are hashed as whole words");
+  std::memcpy(words, &tr, sizeof(Triangle));
+  uint64_t h = Mix(idx + 0x9e3779b97f4a7c15ull);
+  for (uint64_t word : words) {
+    h = Mix(h ^ word);
+  }
+  return h;
+}
+
+}  // namespace
+
+Chromosome::Chromosome(const size_t size, Rng &rng) : size_(size), storage_(size) {
+  triangles_ = storage_.data();
+  for (auto &tr : storage_) {
+    rng.Fill(&tr.vs[0].x, 6, -1.0f, 1.0f);
+    rng.Fill(&tr.color[0], 4);
   }
 }
 
-Chromosome::Chromosome(std::vector<Triangle> triangles) : triangles_(triangles){};
+Chromosome::Chromosome(std::vector<Triangle> triangles) : size_(triangles.size()), storage_(std::move(triangles)) {
+  triangles_ = storage_.data();
+}
 
-void Chromosome::Mutate() {
-  MutationType mutation = MutationType(rand() % MutationType::LAST);
+Chromosome::Chromosome(const Chromosome &other)
+    : size_(other.size_), storage_(other.triangles_, other.triangles_ + other.size_) {
+  triangles_ = storage_.data();
+  CopyState_(other);
+}
+
+Chromosome::Chromosome(Chromosome &&other) : size_(other.size_) {
+  if (other.bound_) {
+    // the arena stays with its store
+    storage_.assign(other.triangles_, other.triangles_ + other.size_);
+  } else {
+    storage_ = std::move(other.storage_);
+    other.triangles_ = nullptr;
+    other.size_ = 0;
+  }
+  triangles_ = storage_.data();
+  CopyState_(other);
+}
+
+Chromosome &Chromosome::operator=(const Chromosome &other) {
+  if (this == &other) {
+    return *this;
+  }
+  if (size_ != other.size_) {
+    assert(!bound_);
+    storage_.resize(other.size_);
+    triangles_ = storage_.data();
+    size_ = other.size_;
+  }
+  std::copy_n(other.triangles_, size_, triangles_);
+  CopyState_(other);
+  return *this;
+}
+
+Chromosome &Chromosome::operator=(Chromosome &&other) {
+  if (bound_ || other.bound_) {
+    return *this = static_cast<const Chromosome &>(other);
+  }
+  storage_ = std::move(other.storage_);
+  triangles_ = storage_.data();
+  size_ = other.size_;
+  other.triangles_ = nullptr;
+  other.size_ = 0;
+  fitness_ = other.fitness_;
+  hash_ = other.hash_;
+  hash_valid_ = other.hash_valid_;
+  render_slot_ = other.render_slot_;
+  squared_error_ = other.squared_error_;
+  changes_ = std::move(other.changes_);
+  return *this;
+}
+
+void Chromosome::Mutate(Rng &rng) {
+  MutationType mutation = MutationType(rng.Below(MutationType::LAST));
   switch (mutation) {
     case COLOR: {
-      int idx = rand() % triangles_.size();
+      int idx = rng.Below(size_);
+      RecordChange_(idx);
+      Unhash_(idx);
       Triangle &tr = triangles_[idx];
-      idx = rand() % 4;
-      tr.color[idx] = rand_float();
+      int channel = rng.Below(4);
+      tr.color[channel] = rng.Float();
+      Rehash_(idx);
       break;
     }
     case ORDER: {
-      assert(triangles_.size() > 1);
-      int idx1 = rand() % triangles_.size();
+      assert(size_ > 1);
+      int idx1 = rng.Below(size_);
       int idx2 = idx1;
       while (idx2 == idx1) {
-        idx1 = rand() % triangles_.size();
+        idx1 = rng.Below(size_);
       }
+      RecordChange_(idx1);
+      RecordChange_(idx2);
+      Unhash_(idx1);
+      Unhash_(idx2);
       std::swap(triangles_[idx1], triangles_[idx2]);
+      Rehash_(idx1);
+      Rehash_(idx2);
       break;
     }
     case POSITION: {
-      int idx = rand() % triangles_.size();
+      int idx = rng.Below(size_);
+      RecordChange_(idx);
+      Unhash_(idx);
       Triangle &tr = triangles_[idx];
-      idx = rand() % 3;
-      tr.vs[idx].x = rand_float(-1.0f, 1.0f);
-      tr.vs[idx].y = rand_float(-1.0f, 1.0f);
+      int vertex = rng.Below(3);
+      tr.vs[vertex].x = rng.Float(-1.0f, 1.0f);
+      tr.vs[vertex].y = rng.Float(-1.0f, 1.0f);
+      Rehash_(idx);
       break;
     }
   }
 }
 
-void Chromosome::Draw(GLuint buffer, int image_width, int image_height) {
-  glBindFramebuffer(GL_FRAMEBUFFER, buffer);
-  glViewport(0, 0, image_width, image_height);
-  glClear(GL_COLOR_BUFFER_BIT);
-  glBegin(GL_TRIANGLES);
-  for (const auto &tr : triangles_) {
-    glColor4f(tr.color.r, tr.color.g, tr.color.b, tr.color.a);
-    for (int i = 0; i < 3; ++i) {
-      glVertex2f(tr.vs[i].x, tr.vs[i].y);
-    }
-  }
-  glEnd();
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+void Chromosome::Draw(RenderBackend &backend, size_t slot) const {
+  backend.Draw(*this, slot);
 }
 
-const std::vector<Triangle> &Chromosome::GetTriangles() const {
+TriangleSpan Chromosome::GetTriangles() const {
+  return {triangles_, size_};
+}
+
+size_t Chromosome::GetSize() const {
+  return size_;
+}
+
+Triangle *Chromosome::Overwrite() {
+  fitness_ = INFINITY;
+  hash_valid_ = false;
+  render_slot_ = kNoSlot;
+  squared_error_ = 0;
+  changes_.clear();
   return triangles_;
 }
 
@@ -71,6 +162,96 @@ float Chromosome::GetFitness() const {
   return fitness_;
 }
 
+uint64_t Chromosome::GetHash() const {
+  if (!hash_valid_) {
+    hash_ = 0;
+    for (size_t i = 0; i < size_; ++i) {
+      hash_ += HashTriangle(i, triangles_[i]);
+    }
+    hash_valid_ = true;
+  }
+  return hash_;
+}
+
 const Triangle &Chromosome::operator[](size_t idx) const {
   return triangles_[idx];
-}
\ No newline at end of file
+}
+void Chromosome::SetRendered(size_t slot, uint64_t squared_error) {
+  render_slot_ = slot;
+  squared_error_ = squared_error;
+  changes_.clear();
+}
+
+size_t Chromosome::GetRenderSlot() const {
+  return render_slot_;
+}
+
+uint64_t Chromosome::GetSquaredError() const {
+  return squared_error_;
+}
+
+const std::vector<TriangleChange> &Chromosome::GetChanges() const {
+  return changes_;
+}
+
+Rect Chromosome::GetDirtyRect(int width, int height) const {
+  Rect rect;
+  for (const auto &change : changes_) {
+    rect = rect.Union(TriangleBounds(change.before, width, height));
+    rect = rect.Union(TriangleBounds(triangles_[change.index], width, height));
+  }
+  return rect;
+}
+
+void Chromosome::Undo() {
+  // most recent first, so a triangle changed twice ends up with its oldest value
+  for (auto change = changes_.rbegin(); change != changes_.rend(); ++change) {
+    Unhash_(change->index);
+    triangles_[change->index] = change->before;
+    Rehash_(change->index);
+  }
+  changes_.clear();
+}
+
+void Chromosome::RecordChange_(size_t idx) {
+  if (render_slot_ == kNoSlot) {
+    return;
+  }
+  // past a few changes the dirty area approaches the whole image, so forget the slot altogether
+  const size_t kMaxChanges = 8;
+  if (changes_.size() == kMaxChanges) {
+    render_slot_ = kNoSlot;
+    changes_.clear();
+    return;
+  }
+  changes_.push_back({idx, triangles_[idx]});
+}
+
+void Chromosome::Bind_(Triangle *triangles, size_t size) {
+  triangles_ = triangles;
+  size_ = size;
+  storage_.clear();
+  storage_.shrink_to_fit();
+  bound_ = true;
+}
+
+void Chromosome::CopyState_(const Chromosome &other) {
+  fitness_ = other.fitness_;
+  hash_ = other.hash_;
+  hash_valid_ = other.hash_valid_;
+  render_slot_ = other.render_slot_;
+  squared_error_ = other.squared_error_;
+  changes_ = other.changes_;
+}
+
+void Chromosome::Unhash_(size_t idx) {
+  if (hash_valid_) {
+    hash_ -= HashTriangle(idx, triangles_[idx]);
+  }
+}
+
+void Chromosome::Rehash_(size_t idx) {
+  if (hash_valid_) {
+    hash_ += HashTriangle(idx, triangles_[idx]);
+  }
+}
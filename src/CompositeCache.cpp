@@ -0,0 +1,157 @@
+#include <CompositeCache.hpp>
+#include <ThreadPool.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// upper bound for prefix and suffix checkpoints together
+const size_t kMemoryBudget = size_t(256) << 20;
+const int kBandHeight = 16;
+
+}  // namespace
+
+bool CompositeCache::Build(const Chromosome &chromosome, int width, int height, ThreadPool *pool) {
+  const auto &triangles = chromosome.GetTriangles();
+  size_t pixel_count = static_cast<size_t>(width) * height;
+  size_t max_checkpoints = kMemoryBudget / (pixel_count * (4 + sizeof(SuffixPixel)));
+  if (triangles.empty() || max_checkpoints < 2) {
+    Clear();
+    return false;
+  }
+
+  // about sqrt(N) triangles between checkpoints balances the redraw cost against memory
+  size_t size = triangles.size();
+  size_t stride = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(size))));
+  if ((size + stride - 1) / stride + 1 > max_checkpoints) {
+    stride = (size + max_checkpoints - 2) / (max_checkpoints - 1);
+  }
+  size_t checkpoints = (size + stride - 1) / stride + 1;
+  width_ = width;
+  height_ = height;
+  size_ = size;
+  stride_ = stride;
+  prefixes_.resize(checkpoints);
+  suffixes_.resize(checkpoints);
+  for (size_t m = 0; m < checkpoints; ++m) {
+    prefixes_[m].resize(4 * pixel_count);
+    suffixes_[m].resize(pixel_count);
+  }
+
+  setups_.resize(size);
+  visible_.resize(size);
+  for (size_t i = 0; i < size; ++i) {
+    visible_[i] = SetupTriangle(triangles[i], width, height, setups_[i]);
+  }
+
+  // bands do not share pixels, so each one can be built on its own thread
+  size_t bands = (height + kBandHeight - 1) / kBandHeight;
+  auto build_band = [this](size_t band, size_t) {
+    int y0 = static_cast<int>(band) * kBandHeight;
+    BuildBand_({0, y0, width_, std::min(height_, y0 + kBandHeight)});
+  };
+  if (pool != nullptr) {
+    pool->ParallelFor(bands, build_band);
+  } else {
+    for (size_t band = 0; band < bands; ++band) {
+      build_band(band, 0);
+    }
+  }
+  return true;
+}
+
+void CompositeCache::BuildBand_(const Rect &band) {
+  size_t last = prefixes_.size() - 1;
+  size_t begin = static_cast<size_t>(band.y0) * width_;
+  size_t count = band.Area();
+
+  // prefixes front to back, each one continues from the previous
+  ClearPixels(band, width_, prefixes_[0].data());
+  for (size_t m = 1; m <= last; ++m) {
+    uint8_t *pixels = prefixes_[m].data();
+    std::memcpy(pixels + 4 * begin, prefixes_[m - 1].data() + 4 * begin, 4 * count);
+    for (size_t i = Checkpoint_(m - 1); i < Checkpoint_(m); ++i) {
+      if (visible_[i]) {
+        DrawTriangle(setups_[i], band, width_, pixels);
+      }
+    }
+  }
+
+  // suffixes back to front, putting each triangle under the map of the ones above it
+  std::fill_n(suffixes_[last].data() + begin, count, SuffixPixel{{0, 0, 0, 0}, 1});
+  for (size_t m = last; m-- > 0;) {
+    SuffixPixel *map = suffixes_[m].data();
+    std::copy_n(suffixes_[m + 1].data() + begin, count, map + begin);
+    for (size_t i = Checkpoint_(m + 1); i-- > Checkpoint_(m);) {
+      if (!visible_[i]) {
+        continue;
+      }
+      const RasterTriangle &tr = setups_[i];
+      float src[4] = {float(tr.src[0]), float(tr.src[1]), float(tr.src[2]), float(tr.src[3])};
+      float inv_alpha = tr.inv_alpha / 255.0f;
+      ForEachSpan(tr, band, [&](int row, int x0, int x1) {
+        SuffixPixel *p = map + static_cast<size_t>(row) * width_;
+        for (int x = x0; x < x1; ++x) {
+          for (int ch = 0; ch < 4; ++ch) {
+            p[x].color[ch] += p[x].transmittance * src[ch];
+          }
+          p[x].transmittance *= inv_alpha;
+        }
+      });
+    }
+  }
+}
+
+void CompositeCache::Draw(const Chromosome &chromosome, size_t lo, size_t hi, const Rect &clip,
+                          uint8_t *pixels) const {
+  Rect rect = clip.Intersect({0, 0, width_, height_});
+  if (rect.IsEmpty()) {
+    return;
+  }
+  size_t first = lo / stride_;
+  size_t last = std::min(prefixes_.size() - 1, hi / stride_ + 1);
+
+  const uint8_t *prefix = prefixes_[first].data();
+  for (int row = rect.y0; row < rect.y1; ++row) {
+    size_t offset = 4 * (static_cast<size_t>(row) * width_ + rect.x0);
+    std::memcpy(pixels + offset, prefix + offset, 4 * static_cast<size_t>(rect.x1 - rect.x0));
+  }
+  RasterTriangle setup;
+  for (size_t i = Checkpoint_(first); i < Checkpoint_(last); ++i) {
+    if (SetupTriangle(chromosome[i], width_, height_, setup)) {
+      DrawTriangle(setup, rect, width_, pixels);
+    }
+  }
+  const SuffixPixel *map = suffixes_[last].data();
+  for (int row = rect.y0; row < rect.y1; ++row) {
+    size_t offset = static_cast<size_t>(row) * width_;
+    for (int x = rect.x0; x < rect.x1; ++x) {
+      const SuffixPixel &s = map[offset + x];
+      uint8_t *p = pixels + 4 * (offset + x);
+      for (int ch = 0; ch < 4; ++ch) {
+        float value = s.color[ch] + s.transmittance * p[ch];
+        p[ch] = static_cast<uint8_t>(std::min(255.0f, value + 0.5f));
+      }
+    }
+  }
+}
+
+bool CompositeCache::IsEmpty() const {
+  return prefixes_.empty();
+}
+
+void CompositeCache::Clear() {
+  prefixes_.clear();
+  suffixes_.clear();
+  size_ = 0;
+  stride_ = 0;
+}
+
+size_t CompositeCache::GetStride() const {
+  return stride_;
+}
+
+size_t CompositeCache::Checkpoint_(size_t m) const {
+  return std::min(m * stride_, size_);
+}
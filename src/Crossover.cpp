@@ -1,63 +1,84 @@
 #include <Crossover.hpp>
 #include <Chromosome.hpp>
 #include <cassert>
+#include <cstring>
 
 const char *crossover_type_names[4] = {"One Point", "Two Point", "Uniform", "None"};
 
-Chromosome OnePointCrossoverStrategy::operator()(const Chromosome &child1, const Chromosome &child2) {
-  assert(child1.GetTriangles().size() == child2.GetTriangles().size());
-  size_t size = child1.GetTriangles().size();
-  size_t idx = rand() % (size - 1) + 1;
-  std::vector<Triangle> triangles(size);
-  for (size_t i = 0; i < idx; ++i) {
-    triangles[i] = child1[i];
-  }
-  for (size_t i = idx; i < size; ++i) {
-    triangles[i] = child2[i];
-  }
-  return Chromosome(std::move(triangles));
+namespace {
+
+// triangles are plain floats, so whole runs of them copy as bytes
+void CopyRange(const Chromosome &from, size_t begin, size_t end, Triangle *to) {
+  std::memcpy(to + begin, from.GetTriangles().data + begin, (end - begin) * sizeof(Triangle));
 }
 
-Chromosome TwoPointCrossoverStrategy::operator()(const Chromosome &child1, const Chromosome &child2) {
-  assert(child1.GetTriangles().size() == child2.GetTriangles().size());
-  size_t size = child1.GetTriangles().size();
-  size_t idx1 = rand() % (size - 1) + 1;
-  size_t idx2 = rand() % (size - 2) + 1;
+}  // namespace
+
+void OnePointCrossoverStrategy::operator()(const Chromosome &parent1, const Chromosome &parent2, Chromosome &child,
+                                           Rng &rng) {
+  assert(parent1.GetSize() == parent2.GetSize() && parent1.GetSize() == child.GetSize());
+  size_t size = parent1.GetSize();
+  size_t idx = rng.Below(size - 1) + 1;
+  Triangle *triangles = child.Overwrite();
+  CopyRange(parent1, 0, idx, triangles);
+  CopyRange(parent2, idx, size, triangles);
+}
+
+void TwoPointCrossoverStrategy::operator()(const Chromosome &parent1, const Chromosome &parent2, Chromosome &child,
+                                           Rng &rng) {
+  assert(parent1.GetSize() == parent2.GetSize() && parent1.GetSize() == child.GetSize());
+  size_t size = parent1.GetSize();
+  size_t idx1 = rng.Below(size - 1) + 1;
+  size_t idx2 = rng.Below(size - 2) + 1;
   if (idx2 >= idx1) {
     idx2++;
   } else {
     std::swap(idx1, idx2);
   }
-  std::vector<Triangle> triangles(size);
-  for (size_t i = 0; i < idx1; ++i) {
-    triangles[i] = child1[i];
-  }
-  for (size_t i = idx1; i < idx2; ++i) {
-    triangles[i] = child2[i];
-  }
-  for (size_t i = idx2; i < size; ++i) {
-    triangles[i] = child1[i];
-  }
-  return Chromosome(std::move(triangles));
+  Triangle *triangles = child.Overwrite();
+  CopyRange(parent1, 0, idx1, triangles);
+  CopyRange(parent2, idx1, idx2, triangles);
+  CopyRange(parent1, idx2, size, triangles);
 }
 
-Chromosome UniformCrossoverStrategy::operator()(const Chromosome &child1, const Chromosome &child2) {
-  assert(child1.GetTriangles().size() == child2.GetTriangles().size());
-  size_t size = child1.GetTriangles().size();
-  std::vector<Triangle> triangles(size);
-  for (size_t i = 0; i < size; ++i) {
-    if (rand() % 2) {
-      triangles[i] = child1[i];
-    } else {
-      triangles[i] = child2[i];
+void UniformCrossoverStrategy::operator()(const Chromosome &parent1, const Chromosome &parent2, Chromosome &child,
+                                          Rng &rng) {
+  assert(parent1.GetSize() == parent2.GetSize() && parent1.GetSize() == child.GetSize());
+  size_t size = parent1.GetSize();
+  const Triangle *parents[2] = {parent2.GetTriangles().data, parent1.GetTriangles().data};
+  Triangle *triangles = child.Overwrite();
+  // every random bit picks the parent of one triangle by indexing instead of a branch that would mispredict
+  // half of the time
+  uint64_t bits = 0;
+  for (size_t i = 0; i < size; ++i, bits >>= 1) {
+    if (i % 64 == 0) {
+      bits = rng();
     }
+    triangles[i] = parents[bits & 1][i];
   }
-  return Chromosome(std::move(triangles));
 }
 
-Chromosome NoneCrossoverStrategy::operator()(const Chromosome &child1, const Chromosome &child2) {
-  assert(child1.GetTriangles().size() == child2.GetTriangles().size());
-  size_t size = child1.GetTriangles().size();
-  std::vector<Triangle> triangles(rand() % 2 ? child1.GetTriangles() : child2.GetTriangles());
-  return Chromosome(std::move(triangles));
-}
\ No newline at end of file
+void NoneCrossoverStrategy::operator()(const Chromosome &parent1, const Chromosome &parent2, Chromosome &child,
+                                       Rng &rng) {
+  assert(parent1.GetSize() == parent2.GetSize() && parent1.GetSize() == child.GetSize());
+  // copy the whole parent so the child keeps its rendered image and can be redrawn incrementally
+  child = rng.Below(2) ? parent1 : parent2;
+}
+
+CrossoverStrategy *CreateCrossover(CrossoverType type) {
+  switch (type) {
+    case ONE_POINT: {
+      return new OnePointCrossoverStrategy();
+    }
+    case TWO_POINT: {
+      return new TwoPointCrossoverStrategy();
+    }
+    case UNIFORM: {
+      return new UniformCrossoverStrategy();
+    }
+    case NONE: {
+      return new NoneCrossoverStrategy();
+    }
+  }
+  return nullptr;
+}
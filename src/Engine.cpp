@@ -0,0 +1,38 @@
+#include <Engine.hpp>
+#include <Annealer.hpp>
+#include <EvolutionStrategy.hpp>
+#include <HeadlessContext.hpp>
+#include <IslandSolver.hpp>
+#include <Solver.hpp>
+#include <SteadyStateSolver.hpp>
+#include <plog/Log.h>
+
+const char *engine_names[4] = {"Genetic algorithm", "Simulated annealing", "(1 + lambda) evolution strategy",
+                               "Steady-state genetic algorithm"};
+
+Engine *CreateEngine(Image image, const SolverOptions &options) {
+  SolverOptions resolved = options;
+  if (resolved.render_backend != SOFTWARE && GLVersion.major == 0 && !HeadlessContext::MakeCurrent()) {
+    // no window created a context and none can be made offscreen
+    PLOGW << "No GL context, falling back to the software backend";
+    resolved.render_backend = SOFTWARE;
+  }
+  switch (resolved.engine) {
+    case GENETIC: {
+      if (resolved.islands > 1) {
+        return new IslandSolver(std::move(image), resolved);
+      }
+      return new Solver(std::move(image), resolved);
+    }
+    case ANNEALING: {
+      return new Annealer(std::move(image), resolved);
+    }
+    case EVOLUTION_STRATEGY: {
+      return new EvolutionStrategy(std::move(image), resolved);
+    }
+    case STEADY_STATE: {
+      return new SteadyStateSolver(std::move(image), resolved);
+    }
+  }
+  return nullptr;
+}
@@ -0,0 +1,144 @@
+#include <EvolutionStrategy.hpp>
+#include <Fitness.hpp>
+#include <Rng.hpp>
+#include <plog/Log.h>
+#include <algorithm>
+#include <cmath>
+
+EvolutionStrategy::EvolutionStrategy(Image image, const SolverOptions &options)
+    : image_(std::move(image)),
+      skip_alpha_(options.skip_alpha),
+      composite_cache_(options.composite_cache),
+      lambda_(std::max<size_t>(1, options.population_size)),
+      seed_(options.seed != 0 ? options.seed : RandomSeed()),
+      initialized_(true) {
+  Pool_ = new ThreadPool(options.threads);
+  PLOGI << "EvolutionStrategy " << this << " uses " << Pool_->GetThreadCount() << " threads, lambda " << lambda_
+        << " and seed " << seed_;
+  pixel_count_ = static_cast<size_t>(image_.width) * image_.height;
+  Backend_ = CreateRenderBackend(options.render_backend, image_.width, image_.height, lambda_ + 1, Pool_);
+  Backend_->SetTarget(image_.pixels.data(), skip_alpha_);
+
+  Rng rng(seed_, 0);
+  parent_ = Chromosome(options.genome_size, rng);
+  parent_.Draw(*Backend_, kParentSlot);
+  if (!Backend_->ComputeSquaredErrors(kParentSlot, 1, &squared_error_)) {
+    Rect image = {0, 0, image_.width, image_.height};
+    squared_error_ = CalcSquaredError(image_, Backend_->GetPixels(kParentSlot), image, skip_alpha_);
+  }
+  parent_.SetRendered(kParentSlot, squared_error_);
+  parent_.SetFitness(SquaredErrorFitness(squared_error_, pixel_count_, skip_alpha_));
+  if (composite_cache_) {
+    Backend_->CacheSlot(parent_, kParentSlot);
+  }
+
+  // the children are allocated once and overwritten with the parent every generation
+  children_.assign(lambda_, parent_);
+  errors_.resize(lambda_);
+  rects_.assign(lambda_, Rect());
+  for (size_t i = 0; i < lambda_; ++i) {
+    Backend_->CopySlot(kParentSlot, 1 + i);
+  }
+}
+
+IterationResult EvolutionStrategy::Iteration() {
+  IterationResult result = {0};
+  result.iteration = ++iteration_;
+  if (Backend_->IsThreadSafe()) {
+    EvaluatePartial_();
+  } else {
+    EvaluateFull_();
+  }
+
+  size_t best = 0;
+  result.worst_fitness = INFINITY;
+  for (size_t i = 0; i < lambda_; ++i) {
+    if (errors_[i] < errors_[best]) {
+      best = i;
+    }
+    float fitness = SquaredErrorFitness(errors_[i], pixel_count_, skip_alpha_);
+    result.worst_fitness = std::min(result.worst_fitness, fitness);
+    result.mean_fitness += fitness;
+  }
+  result.mean_fitness /= lambda_;
+
+  if (errors_[best] < squared_error_) {
+    // the best child's slot differs from the parent's only inside its rect, and every other child slot now
+    // differs from the parent's there as well
+    Backend_->CopyRegion(1 + best, kParentSlot, rects_[best]);
+    for (size_t i = 0; i < lambda_; ++i) {
+      if (i != best) {
+        rects_[i] = rects_[i].Union(rects_[best]);
+      }
+    }
+    rects_[best] = Rect();
+    parent_ = children_[best];
+    squared_error_ = errors_[best];
+    parent_.SetRendered(kParentSlot, squared_error_);
+    parent_.SetFitness(SquaredErrorFitness(squared_error_, pixel_count_, skip_alpha_));
+    if (composite_cache_) {
+      Backend_->CacheSlot(parent_, kParentSlot);
+    }
+  }
+  result.best_fitness = parent_.GetFitness();
+  result.texture = Backend_->GetTexture(kParentSlot);
+  return result;
+}
+
+void EvolutionStrategy::Cleanup() {
+  if (initialized_) {
+    PLOGI << "Cleaning up object " << this;
+    delete Backend_;
+    delete Pool_;
+  } else {
+    PLOGI << "Nothing to clean up";
+  }
+}
+
+GLuint EvolutionStrategy::GetBestTexture() const {
+  return Backend_->GetTexture(kParentSlot);
+}
+
+void EvolutionStrategy::EvaluatePartial_() {
+  uint64_t stream = iteration_ * lambda_;
+  // the task captures no more than fits into std::function without a heap allocation
+  Pool_->ParallelFor(lambda_, [this, stream](size_t i, size_t) {
+    size_t slot = 1 + i;
+    Chromosome &child = children_[i];
+    // bring the slot back to the parent's image before drawing the next child over it
+    Backend_->CopyRegion(kParentSlot, slot, rects_[i]);
+    child = parent_;
+    Rng rng(seed_, stream + i);
+    child.Mutate(rng);
+
+    Rect rect = child.GetDirtyRect(image_.width, image_.height);
+    if (Backend_->RedrawRegion(child, kParentSlot, slot, rect)) {
+      rects_[i] = rect;
+      errors_[i] = squared_error_ - CalcSquaredError(image_, Backend_->GetPixels(kParentSlot), rect, skip_alpha_) +
+                   CalcSquaredError(image_, Backend_->GetPixels(slot), rect, skip_alpha_);
+    } else {
+      rects_[i] = {0, 0, image_.width, image_.height};
+      child.Draw(*Backend_, slot);
+      errors_[i] = CalcSquaredError(image_, Backend_->GetPixels(slot), rects_[i], skip_alpha_);
+    }
+  });
+}
+
+void EvolutionStrategy::EvaluateFull_() {
+  // only breeding runs on the pool, GL calls stay on this thread
+  uint64_t stream = iteration_ * lambda_;
+  Pool_->ParallelFor(lambda_, [this, stream](size_t i, size_t) {
+    children_[i] = parent_;
+    Rng rng(seed_, stream + i);
+    children_[i].Mutate(rng);
+  });
+  Backend_->DrawBatch(children_, 1);
+  if (!Backend_->ComputeSquaredErrors(1, lambda_, errors_.data())) {
+    for (size_t i = 0; i < lambda_; ++i) {
+      Rect image = {0, 0, image_.width, image_.height};
+      errors_[i] = CalcSquaredError(image_, Backend_->GetPixels(1 + i), image, skip_alpha_);
+    }
+  }
+  // every child slot holds a whole image, so the winner is copied in full
+  std::fill(rects_.begin(), rects_.end(), Rect{0, 0, image_.width, image_.height});
+}
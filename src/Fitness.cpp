@@ -0,0 +1,22 @@
+#include <Fitness.hpp>
+#include <Kernels.hpp>
+
+uint64_t CalcSquaredError(const Image &target, const GLubyte *pixels, const Rect &rect, bool skip_alpha) {
+  size_t offset = static_cast<size_t>(rect.y0) * target.width + rect.x0;
+  const GLubyte *target_pixels = target.pixels.data();
+  if (rect.x0 == 0 && rect.x1 == target.width) {
+    // whole rows are contiguous
+    return SquaredError(pixels + 4 * offset, target_pixels + 4 * offset, rect.Area(), skip_alpha);
+  }
+  uint64_t se = 0;
+  for (int row = rect.y0; row < rect.y1; ++row, offset += target.width) {
+    se += SquaredError(pixels + 4 * offset, target_pixels + 4 * offset, rect.x1 - rect.x0, skip_alpha);
+  }
+  return se;
+}
+
+double SquaredErrorFitness(uint64_t squared_error, size_t pixel_count, bool skip_alpha) {
+  double samples = static_cast<double>(pixel_count * (skip_alpha ? 3 : 4));
+  double mse = static_cast<double>(squared_error) / samples;
+  return samples / mse;
+}
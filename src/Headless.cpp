@@ -0,0 +1,176 @@
+#include <Headless.hpp>
+#include <Solver.hpp>
+#include <Utils.hpp>
+#include <plog/Log.h>
+#include <plog/Init.h>
+#include <plog/Appenders/ConsoleAppender.h>
+#include <plog/Formatters/TxtFormatter.h>
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <string>
+
+Headless::Headless(int argc, char *argv[]) {
+  options_.render_backend = SOFTWARE;
+  InitLogging();
+  valid_ = ParseArguments(argc, argv);
+}
+
+int Headless::Run() {
+  if (!valid_) {
+    PLOGE << "Usage: app --headless <image> [--iterations N] [--population N] [--genome N] [--cleansing-rate F] "
+             "[--skip-alpha] [--threads N] [--composite-cache] [--backend software|opengl|opengl-layered] "
+             "[--coarse-levels N] [--stall N] [--racing F] [--racing-budget F] "
+             "[--early-abort] [--memo] [--seed N] [--engine ga|sa|es|ss] [--schedule NAME] [--schedule-length N] "
+             "[--temperature F] [--islands N] [--migration-interval N] [--migrants N] [--topology ring|random]";
+    return 1;
+  }
+  Image image;
+  if (!LoadImageFromFile(input_path_, image)) {
+    return 1;
+  }
+
+  std::unique_ptr<Engine> engine(CreateEngine(image, options_));
+  PLOGI << "Started algorithm";
+  for (size_t i = 0; i < iterations_; ++i) {
+    IterationResult res = engine->Iteration();
+    if (res.iteration % 100 == 0 || i + 1 == iterations_) {
+      PLOGI << "Iteration " << res.iteration << " (level " << res.level << "): best " << res.best_fitness
+            << ", mean " << res.mean_fitness << ", worst " << res.worst_fitness;
+    }
+  }
+  engine->Cleanup();
+  return 0;
+}
+
+void Headless::InitLogging() {
+  static plog::ConsoleAppender<plog::TxtFormatter> consoleAppender;
+  plog::init(plog::info, &consoleAppender);
+}
+
+bool Headless::ParseArguments(int argc, char *argv[]) {
+  for (int i = 0; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.rfind("--", 0) != 0) {
+      input_path_ = arg;
+      continue;
+    }
+    if (arg == "--skip-alpha") {
+      options_.skip_alpha = true;
+      continue;
+    }
+    if (arg == "--composite-cache") {
+      options_.composite_cache = true;
+      continue;
+    }
+    if (arg == "--early-abort") {
+      options_.early_abort = true;
+      continue;
+    }
+    if (arg == "--memo") {
+      options_.fitness_memo = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      PLOGE << "Missing value for " << arg;
+      return false;
+    }
+    const char *value = argv[++i];
+    // numbers that do not parse make std::stoul and friends throw
+    try {
+      if (!ParseOption(arg, value)) {
+        return false;
+      }
+    } catch (const std::exception &) {
+      PLOGE << "Invalid value " << value << " for " << arg;
+      return false;
+    }
+  }
+  return !input_path_.empty();
+}
+
+bool Headless::ParseOption(const std::string &arg, const char *value) {
+  if (arg == "--iterations") {
+    iterations_ = std::stoul(value);
+  } else if (arg == "--population") {
+    options_.population_size = std::max<size_t>(2, std::stoul(value));
+  } else if (arg == "--genome") {
+    options_.genome_size = std::max<size_t>(2, std::stoul(value));
+  } else if (arg == "--cleansing-rate") {
+    options_.cleansing_rate = clamp(std::stof(value), 0.0f, 1.0f);
+  } else if (arg == "--threads") {
+    options_.threads = std::stoul(value);
+  } else if (arg == "--coarse-levels") {
+    options_.coarse_levels = std::stoul(value);
+  } else if (arg == "--stall") {
+    options_.stall_generations = std::stoul(value);
+  } else if (arg == "--engine") {
+    std::string engine = value;
+    if (engine == "ga") {
+      options_.engine = GENETIC;
+    } else if (engine == "sa") {
+      options_.engine = ANNEALING;
+    } else if (engine == "es") {
+      options_.engine = EVOLUTION_STRATEGY;
+    } else if (engine == "ss") {
+      options_.engine = STEADY_STATE;
+    } else {
+      PLOGE << "Unknown engine " << engine;
+      return false;
+    }
+  } else if (arg == "--schedule") {
+    // lower case schedule names with dashes, e.g. geman-50 or linear-reheat
+    const char *keys[] = {"geman-1",   "geman-50", "geman-195075",  "linear", "staircase",
+                          "sigmoid",   "geometric", "linear-reheat", "cosine"};
+    std::string schedule = value;
+    auto key = std::find(std::begin(keys), std::end(keys), schedule);
+    if (key == std::end(keys)) {
+      PLOGE << "Unknown schedule " << schedule;
+      return false;
+    }
+    options_.schedule = ScheduleType(key - std::begin(keys));
+  } else if (arg == "--schedule-length") {
+    options_.schedule_length = std::stoul(value);
+  } else if (arg == "--temperature") {
+    options_.temperature = std::max(0.0f, std::stof(value));
+  } else if (arg == "--islands") {
+    options_.islands = std::max<size_t>(1, std::stoul(value));
+  } else if (arg == "--migration-interval") {
+    options_.migration_interval = std::max<size_t>(1, std::stoul(value));
+  } else if (arg == "--migrants") {
+    options_.migrants = std::stoul(value);
+  } else if (arg == "--topology") {
+    std::string topology = value;
+    if (topology == "ring") {
+      options_.migration_topology = RING;
+    } else if (topology == "random") {
+      options_.migration_topology = RANDOM_RING;
+    } else {
+      PLOGE << "Unknown topology " << topology;
+      return false;
+    }
+  } else if (arg == "--seed") {
+    options_.seed = std::stoull(value);
+  } else if (arg == "--racing") {
+    options_.racing_fraction = clamp(std::stof(value), 0.0f, 1.0f);
+  } else if (arg == "--racing-budget") {
+    options_.racing_rejection_budget = clamp(std::stof(value), 0.0f, 0.5f);
+  } else if (arg == "--backend") {
+    // the GL backends get an offscreen context from the solver
+    std::string backend = value;
+    if (backend == "software") {
+      options_.render_backend = SOFTWARE;
+    } else if (backend == "opengl") {
+      options_.render_backend = OPENGL;
+    } else if (backend == "opengl-layered") {
+      options_.render_backend = OPENGL_LAYERED;
+    } else {
+      PLOGE << "Unknown backend " << backend;
+      return false;
+    }
+  } else {
+    PLOGE << "Unknown option " << arg;
+    return false;
+  }
+  return true;
+}
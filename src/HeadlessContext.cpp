@@ -0,0 +1,150 @@
+#include <HeadlessContext.hpp>
+#include <glad/glad.h>
+#include <plog/Log.h>
+
+#ifdef PFP_HAVE_EGL
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+
+namespace {
+
+struct EglState {
+  EGLDisplay display = EGL_NO_DISPLAY;
+  EGLSurface surface = EGL_NO_SURFACE;
+  EGLContext context = EGL_NO_CONTEXT;
+};
+
+bool HasExtension(const char *extensions, const char *name) {
+  if (extensions == nullptr) {
+    return false;
+  }
+  size_t length = std::strlen(name);
+  for (const char *p = std::strstr(extensions, name); p != nullptr; p = std::strstr(p + length, name)) {
+    if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0')) {
+      return true;
+    }
+  }
+  return false;
+}
+
+EGLDisplay OpenDisplay(bool &surfaceless) {
+  const char *client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  surfaceless = false;
+  if (HasExtension(client_extensions, "EGL_MESA_platform_surfaceless")) {
+    auto get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display != nullptr) {
+      EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+      if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL)) {
+        surfaceless = true;
+        return display;
+      }
+    }
+  }
+  EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL)) {
+    return display;
+  }
+  return EGL_NO_DISPLAY;
+}
+
+EGLContext CreateContext(EGLDisplay display, EGLConfig config) {
+  // newest first, the last entry takes whatever legacy context the driver offers
+  const EGLint versions[][2] = {{4, 5}, {3, 3}, {0, 0}};
+  for (const auto &version : versions) {
+    EGLint attributes[] = {EGL_CONTEXT_MAJOR_VERSION,
+                           version[0],
+                           EGL_CONTEXT_MINOR_VERSION,
+                           version[1],
+                           EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                           EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+                           EGL_NONE};
+    EGLContext context =
+        eglCreateContext(display, config, EGL_NO_CONTEXT, version[0] > 0 ? attributes : attributes + 6);
+    if (context != EGL_NO_CONTEXT) {
+      return context;
+    }
+  }
+  return EGL_NO_CONTEXT;
+}
+
+bool CreateState(EglState &state) {
+  bool surfaceless;
+  state.display = OpenDisplay(surfaceless);
+  if (state.display == EGL_NO_DISPLAY) {
+    PLOGE << "No EGL display available";
+    return false;
+  }
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    PLOGE << "EGL display has no desktop GL";
+    return false;
+  }
+
+  const char *extensions = eglQueryString(state.display, EGL_EXTENSIONS);
+  EGLConfig config = EGL_NO_CONFIG_KHR;
+  bool needs_surface = !(surfaceless && HasExtension(extensions, "EGL_KHR_no_config_context") &&
+                         HasExtension(extensions, "EGL_KHR_surfaceless_context"));
+  if (needs_surface) {
+    const EGLint config_attributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                        EGL_RED_SIZE,     8,               EGL_GREEN_SIZE,      8,
+                                        EGL_BLUE_SIZE,    8,               EGL_ALPHA_SIZE,      8,
+                                        EGL_NONE};
+    EGLint count = 0;
+    if (!eglChooseConfig(state.display, config_attributes, &config, 1, &count) || count == 0) {
+      PLOGE << "No EGL config for a pbuffer with desktop GL";
+      return false;
+    }
+    const EGLint pbuffer_attributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    state.surface = eglCreatePbufferSurface(state.display, config, pbuffer_attributes);
+    if (state.surface == EGL_NO_SURFACE) {
+      PLOGE << "Failed to create an EGL pbuffer";
+      return false;
+    }
+  }
+
+  state.context = CreateContext(state.display, config);
+  if (state.context == EGL_NO_CONTEXT) {
+    PLOGE << "Failed to create an EGL context";
+    return false;
+  }
+  PLOGI << "Created EGL context on " << (surfaceless ? "the surfaceless platform" : "the default display")
+        << (needs_surface ? " with a pbuffer" : "");
+  return true;
+}
+
+}  // namespace
+
+bool HeadlessContext::MakeCurrent() {
+  static EglState state;
+  static bool created = CreateState(state);
+  if (!created) {
+    return false;
+  }
+  if (!eglMakeCurrent(state.display, state.surface, state.surface, state.context)) {
+    PLOGE << "Failed to make the EGL context current";
+    return false;
+  }
+  if (GLVersion.major == 0) {
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+      PLOGE << "Init GLAD: FAIL";
+      return false;
+    }
+    PLOGI << "Headless GL " << GLVersion.major << "." << GLVersion.minor << ": " << reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+  }
+  // same state the GUI sets up for its window
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+  return true;
+}
+
+#else
+
+bool HeadlessContext::MakeCurrent() {
+  PLOGE << "Built without EGL, no headless GL context available";
+  return false;
+}
+
+#endif
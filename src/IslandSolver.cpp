@@ -0,0 +1,128 @@
+#include <IslandSolver.hpp>
+#include <Rng.hpp>
+#include <plog/Log.h>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+const char *migration_topology_names[2] = {"Ring", "Random ring"};
+
+IslandSolver::IslandSolver(Image image, const SolverOptions &options)
+    : migration_interval_(std::max<size_t>(1, options.migration_interval)),
+      migrants_(options.migrants),
+      topology_(options.migration_topology),
+      seed_(options.seed != 0 ? options.seed : RandomSeed()),
+      parallel_(options.render_backend == SOFTWARE),
+      initialized_(true),
+      mailboxes_(2 * std::max<size_t>(1, options.islands)),
+      targets_(mailboxes_.size() / 2),
+      results_(mailboxes_.size() / 2) {
+  size_t islands = targets_.size();
+  Pool_ = new ThreadPool(options.threads);
+  PLOGI << "IslandSolver " << this << " runs " << islands << " islands on " << Pool_->GetThreadCount()
+        << " threads with seed " << seed_;
+  if (!parallel_) {
+    PLOGW << "The GL backends draw on one context, islands run one after another";
+  }
+
+  // every island gets one thread and a seed of its own derived from the run's seed
+  SolverOptions island = options;
+  island.islands = 1;
+  island.threads = 1;
+  islands_.resize(islands);
+  for (size_t k = 0; k < islands; ++k) {
+    Rng rng(seed_, k);
+    island.seed = rng() | 1;
+    islands_[k] = new Solver(image, island);
+  }
+  std::iota(targets_.begin(), targets_.end(), 1);
+  targets_.back() = 0;
+}
+
+IterationResult IslandSolver::Iteration() {
+  ++iteration_;
+  for (Solver *island : islands_) {
+    island->RefineLevel();
+  }
+  bool migrate = islands_.size() > 1 && migrants_ > 0 && iteration_ % migration_interval_ == 0;
+  if (migrate && topology_ == RANDOM_RING) {
+    PlanMigration_();
+  }
+  if (parallel_) {
+    Pool_->ParallelFor(islands_.size(), [this, migrate](size_t k, size_t) { RunIsland_(k, migrate); });
+  } else {
+    for (size_t k = 0; k < islands_.size(); ++k) {
+      RunIsland_(k, migrate);
+    }
+  }
+
+  IterationResult result = {0};
+  result.iteration = iteration_;
+  result.worst_fitness = INFINITY;
+  // the fittest child of this generation, and the island with the best image so far
+  size_t best = 0;
+  best_island_ = 0;
+  for (size_t k = 0; k < islands_.size(); ++k) {
+    if (results_[k].best_fitness > results_[best].best_fitness) {
+      best = k;
+    }
+    if (islands_[k]->GetBestFitness() > islands_[best_island_]->GetBestFitness()) {
+      best_island_ = k;
+    }
+    result.worst_fitness = std::min(result.worst_fitness, results_[k].worst_fitness);
+    result.mean_fitness += results_[k].mean_fitness;
+  }
+  result.mean_fitness /= islands_.size();
+  result.best_fitness = results_[best].best_fitness;
+  result.level = results_[best].level;
+  result.texture = islands_[best_island_]->GetBestTexture();
+  return result;
+}
+
+void IslandSolver::Cleanup() {
+  if (initialized_) {
+    PLOGI << "Cleaning up object " << this;
+    for (Solver *island : islands_) {
+      island->Cleanup();
+      delete island;
+    }
+    delete Pool_;
+  } else {
+    PLOGI << "Nothing to clean up";
+  }
+}
+
+GLuint IslandSolver::GetBestTexture() const {
+  return islands_[best_island_]->GetBestTexture();
+}
+
+void IslandSolver::RunIsland_(size_t k, bool migrate) {
+  Solver *island = islands_[k];
+  Mailbox &inbox = mailboxes_[2 * k + (iteration_ - 1) % 2];
+  if (inbox.full.load(std::memory_order_acquire)) {
+    island->Immigrate(inbox.migrants);
+    inbox.full.store(false, std::memory_order_release);
+  }
+  results_[k] = island->Evolve();
+  if (migrate) {
+    // a mailbox whose island has not taken the last migrants yet keeps them and these are dropped
+    Mailbox &outbox = mailboxes_[2 * targets_[k] + iteration_ % 2];
+    if (!outbox.full.load(std::memory_order_acquire)) {
+      island->Emigrate(migrants_, outbox.migrants);
+      outbox.full.store(true, std::memory_order_release);
+    }
+  }
+}
+
+void IslandSolver::PlanMigration_() {
+  // a ring through the islands in a random order, so every mailbox still has exactly one sender
+  std::vector<size_t> order(islands_.size());
+  std::iota(order.begin(), order.end(), 0);
+  Rng rng(seed_, islands_.size() + iteration_);
+  for (size_t i = order.size() - 1; i > 0; --i) {
+    std::swap(order[i], order[rng.Below(i + 1)]);
+  }
+  for (size_t i = 0; i < order.size(); ++i) {
+    targets_[order[i]] = order[(i + 1) % order.size()];
+  }
+}
@@ -0,0 +1,286 @@
+#include <Kernels.hpp>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PFP_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+const char *kernel_level_names[KERNEL_LEVEL_COUNT] = {"Scalar", "SSE2", "AVX2", "AVX-512"};
+
+namespace {
+
+inline uint32_t Div255(uint32_t x) {
+  // exact round(x / 255) for x in [0, 255 * 255]
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+void BlendSpanScalar(uint8_t *dst, size_t count, const uint8_t src[4], uint8_t inv_alpha) {
+  for (size_t i = 0; i < count; ++i, dst += 4) {
+    for (int ch = 0; ch < 4; ++ch) {
+      dst[ch] = src[ch] + Div255(dst[ch] * inv_alpha);
+    }
+  }
+}
+
+uint64_t SquaredErrorScalar(const uint8_t *a, const uint8_t *b, size_t count, bool skip_alpha) {
+  uint64_t se = 0;
+  int channels = skip_alpha ? 3 : 4;
+  for (size_t i = 0; i < count; ++i, a += 4, b += 4) {
+    for (int ch = 0; ch < channels; ++ch) {
+      int diff = a[ch] - b[ch];
+      se += diff * diff;
+    }
+  }
+  return se;
+}
+
+#ifdef PFP_X86_KERNELS
+
+// The squared error kernels take |a - b| with two saturating subtractions, widen it to 16 bits and
+// square and pairwise add it with madd into 32 bit lanes. Every step adds the madd of the low and of the
+// high half to the same lane, up to 4 * 255^2, so lanes are flushed into 64 bit totals every kFlushSteps
+// steps, before they could overflow.
+const size_t kFlushSteps = 4096;
+static_assert(kFlushSteps <= INT32_MAX / (4 * 255 * 255), "32 bit squared error lanes would overflow");
+
+// The vector kernels widen bytes to 16 bit lanes, where d * inv_alpha + 128 never exceeds 65153, so the
+// same Div255 trick works without leaving 16 bits. Source terms are added after the division and the
+// result always fits a byte, packus only undoes the widening.
+
+__attribute__((target("sse2"))) inline __m128i Blend16Sse2(__m128i d, __m128i src, __m128i inv, __m128i bias) {
+  __m128i t = _mm_add_epi16(_mm_mullo_epi16(d, inv), bias);
+  t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+  return _mm_add_epi16(t, src);
+}
+
+__attribute__((target("sse2"))) void BlendSpanSse2(uint8_t *dst, size_t count, const uint8_t src[4],
+                                                   uint8_t inv_alpha) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i src16 = _mm_setr_epi16(src[0], src[1], src[2], src[3], src[0], src[1], src[2], src[3]);
+  const __m128i inv = _mm_set1_epi16(inv_alpha);
+  const __m128i bias = _mm_set1_epi16(128);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4, dst += 16) {
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst));
+    __m128i lo = Blend16Sse2(_mm_unpacklo_epi8(d, zero), src16, inv, bias);
+    __m128i hi = Blend16Sse2(_mm_unpackhi_epi8(d, zero), src16, inv, bias);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_packus_epi16(lo, hi));
+  }
+  BlendSpanScalar(dst, count - i, src, inv_alpha);
+}
+
+__attribute__((target("avx2"))) inline __m256i Blend16Avx2(__m256i d, __m256i src, __m256i inv, __m256i bias) {
+  __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(d, inv), bias);
+  t = _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+  return _mm256_add_epi16(t, src);
+}
+
+__attribute__((target("avx2"))) void BlendSpanAvx2(uint8_t *dst, size_t count, const uint8_t src[4],
+                                                   uint8_t inv_alpha) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i src16 = _mm256_setr_epi16(src[0], src[1], src[2], src[3], src[0], src[1], src[2], src[3], src[0],
+                                          src[1], src[2], src[3], src[0], src[1], src[2], src[3]);
+  const __m256i inv = _mm256_set1_epi16(inv_alpha);
+  const __m256i bias = _mm256_set1_epi16(128);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8, dst += 32) {
+    // unpack and pack both work within 128 bit lanes, so the pixel order survives the round trip
+    __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst));
+    __m256i lo = Blend16Avx2(_mm256_unpacklo_epi8(d, zero), src16, inv, bias);
+    __m256i hi = Blend16Avx2(_mm256_unpackhi_epi8(d, zero), src16, inv, bias);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_packus_epi16(lo, hi));
+  }
+  if (i < count) {
+    // one pixel is one 32 bit element, so the tail can use masked moves instead of a scalar loop
+    __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(count - i)),
+                                      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256i d = _mm256_maskload_epi32(reinterpret_cast<const int *>(dst), mask);
+    __m256i lo = Blend16Avx2(_mm256_unpacklo_epi8(d, zero), src16, inv, bias);
+    __m256i hi = Blend16Avx2(_mm256_unpackhi_epi8(d, zero), src16, inv, bias);
+    _mm256_maskstore_epi32(reinterpret_cast<int *>(dst), mask, _mm256_packus_epi16(lo, hi));
+  }
+}
+
+__attribute__((target("avx512f,avx512bw"))) inline __m512i Blend16Avx512(__m512i d, __m512i src, __m512i inv,
+                                                                         __m512i bias) {
+  __m512i t = _mm512_add_epi16(_mm512_mullo_epi16(d, inv), bias);
+  t = _mm512_srli_epi16(_mm512_add_epi16(t, _mm512_srli_epi16(t, 8)), 8);
+  return _mm512_add_epi16(t, src);
+}
+
+__attribute__((target("avx512f,avx512bw"))) void BlendSpanAvx512(uint8_t *dst, size_t count, const uint8_t src[4],
+                                                                 uint8_t inv_alpha) {
+  const __m512i zero = _mm512_setzero_si512();
+  uint32_t color;
+  __builtin_memcpy(&color, src, 4);
+  // four bytes of the color widened to 16 bits, repeated over the whole register
+  const __m512i src16 = _mm512_cvtepu8_epi16(_mm256_set1_epi32(static_cast<int>(color)));
+  const __m512i inv = _mm512_set1_epi16(inv_alpha);
+  const __m512i bias = _mm512_set1_epi16(128);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16, dst += 64) {
+    __m512i d = _mm512_loadu_si512(dst);
+    __m512i lo = Blend16Avx512(_mm512_unpacklo_epi8(d, zero), src16, inv, bias);
+    __m512i hi = Blend16Avx512(_mm512_unpackhi_epi8(d, zero), src16, inv, bias);
+    _mm512_storeu_si512(dst, _mm512_packus_epi16(lo, hi));
+  }
+  if (i < count) {
+    // masked tail keeps short spans, the common case for small triangles, in vector registers
+    __mmask64 mask = (1ull << (4 * (count - i))) - 1;
+    __m512i d = _mm512_maskz_loadu_epi8(mask, dst);
+    __m512i lo = Blend16Avx512(_mm512_unpacklo_epi8(d, zero), src16, inv, bias);
+    __m512i hi = Blend16Avx512(_mm512_unpackhi_epi8(d, zero), src16, inv, bias);
+    _mm512_mask_storeu_epi8(dst, mask, _mm512_packus_epi16(lo, hi));
+  }
+}
+
+__attribute__((target("sse2"))) inline __m128i AbsDiffSse2(const uint8_t *a, const uint8_t *b, __m128i mask) {
+  __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+  __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+  return _mm_and_si128(_mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va)), mask);
+}
+
+__attribute__((target("sse2"))) inline uint64_t HorizontalSumSse2(__m128i sum32) {
+  __m128i sum64 = _mm_add_epi64(_mm_unpacklo_epi32(sum32, _mm_setzero_si128()),
+                                _mm_unpackhi_epi32(sum32, _mm_setzero_si128()));
+  // _mm_cvtsi128_si64 only exists on x86-64, a store works on 32 bit x86 too
+  uint64_t halves[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(halves), sum64);
+  return halves[0] + halves[1];
+}
+
+__attribute__((target("sse2"))) uint64_t SquaredErrorSse2(const uint8_t *a, const uint8_t *b, size_t count,
+                                                          bool skip_alpha) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i mask = _mm_set1_epi32(skip_alpha ? 0x00ffffff : -1);
+  uint64_t se = 0;
+  size_t i = 0;
+  while (i + 4 <= count) {
+    __m128i sum = _mm_setzero_si128();
+    size_t steps_end = std::min(count, i + 4 * kFlushSteps);
+    for (; i + 4 <= steps_end; i += 4, a += 16, b += 16) {
+      __m128i d = AbsDiffSse2(a, b, mask);
+      __m128i lo = _mm_unpacklo_epi8(d, zero);
+      __m128i hi = _mm_unpackhi_epi8(d, zero);
+      sum = _mm_add_epi32(sum, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+    }
+    se += HorizontalSumSse2(sum);
+  }
+  return se + SquaredErrorScalar(a, b, count - i, skip_alpha);
+}
+
+__attribute__((target("avx2"))) uint64_t SquaredErrorAvx2(const uint8_t *a, const uint8_t *b, size_t count,
+                                                          bool skip_alpha) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i mask = _mm256_set1_epi32(skip_alpha ? 0x00ffffff : -1);
+  uint64_t se = 0;
+  size_t i = 0;
+  while (i + 8 <= count) {
+    __m256i sum = _mm256_setzero_si256();
+    size_t steps_end = std::min(count, i + 8 * kFlushSteps);
+    for (; i + 8 <= steps_end; i += 8, a += 32, b += 32) {
+      __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a));
+      __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b));
+      __m256i d = _mm256_and_si256(_mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va)), mask);
+      __m256i lo = _mm256_unpacklo_epi8(d, zero);
+      __m256i hi = _mm256_unpackhi_epi8(d, zero);
+      sum = _mm256_add_epi32(sum, _mm256_add_epi32(_mm256_madd_epi16(lo, lo), _mm256_madd_epi16(hi, hi)));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    se += HorizontalSumSse2(half);
+  }
+  return se + SquaredErrorSse2(a, b, count - i, skip_alpha);
+}
+
+__attribute__((target("avx512f,avx512bw"))) inline __m512i SquaredDiffAvx512(__m512i va, __m512i vb, __m512i mask) {
+  const __m512i zero = _mm512_setzero_si512();
+  __m512i d = _mm512_and_si512(_mm512_or_si512(_mm512_subs_epu8(va, vb), _mm512_subs_epu8(vb, va)), mask);
+  __m512i lo = _mm512_unpacklo_epi8(d, zero);
+  __m512i hi = _mm512_unpackhi_epi8(d, zero);
+  return _mm512_add_epi32(_mm512_madd_epi16(lo, lo), _mm512_madd_epi16(hi, hi));
+}
+
+__attribute__((target("avx512f,avx512bw"))) inline uint64_t HorizontalSumAvx512(__m512i sum32) {
+  __m512i sum64 = _mm512_add_epi64(_mm512_cvtepu32_epi64(_mm512_castsi512_si256(sum32)),
+                                   _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(sum32, 1)));
+  return static_cast<uint64_t>(_mm512_reduce_add_epi64(sum64));
+}
+
+__attribute__((target("avx512f,avx512bw"))) uint64_t SquaredErrorAvx512(const uint8_t *a, const uint8_t *b,
+                                                                        size_t count, bool skip_alpha) {
+  const __m512i mask = _mm512_set1_epi32(skip_alpha ? 0x00ffffff : -1);
+  uint64_t se = 0;
+  size_t i = 0;
+  while (i + 16 <= count) {
+    __m512i sum = _mm512_setzero_si512();
+    size_t steps_end = std::min(count, i + 16 * kFlushSteps);
+    for (; i + 16 <= steps_end; i += 16, a += 64, b += 64) {
+      sum = _mm512_add_epi32(sum, SquaredDiffAvx512(_mm512_loadu_si512(a), _mm512_loadu_si512(b), mask));
+    }
+    se += HorizontalSumAvx512(sum);
+  }
+  if (i < count) {
+    // masked lanes read as zero on both sides and add nothing
+    __mmask64 load = (1ull << (4 * (count - i))) - 1;
+    se += HorizontalSumAvx512(
+        SquaredDiffAvx512(_mm512_maskz_loadu_epi8(load, a), _mm512_maskz_loadu_epi8(load, b), mask));
+  }
+  return se;
+}
+
+#endif
+
+}  // namespace
+
+KernelLevel DetectKernelLevel() {
+#ifdef PFP_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+    return AVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return AVX2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return SSE2;
+  }
+#endif
+  return SCALAR;
+}
+
+BlendSpanKernel GetBlendSpanKernel(KernelLevel level) {
+#ifdef PFP_X86_KERNELS
+  switch (level) {
+    case AVX512:
+      return BlendSpanAvx512;
+    case AVX2:
+      return BlendSpanAvx2;
+    case SSE2:
+      return BlendSpanSse2;
+    default:
+      break;
+  }
+#endif
+  return BlendSpanScalar;
+}
+
+SquaredErrorKernel GetSquaredErrorKernel(KernelLevel level) {
+#ifdef PFP_X86_KERNELS
+  switch (level) {
+    case AVX512:
+      return SquaredErrorAvx512;
+    case AVX2:
+      return SquaredErrorAvx2;
+    case SSE2:
+      return SquaredErrorSse2;
+    default:
+      break;
+  }
+#endif
+  return SquaredErrorScalar;
+}
+
+const BlendSpanKernel BlendSpan = GetBlendSpanKernel(DetectKernelLevel());
+const SquaredErrorKernel SquaredError = GetSquaredErrorKernel(DetectKernelLevel());
@@ -0,0 +1,39 @@
+#include <PopulationStore.hpp>
+
+PopulationStore::PopulationStore(size_t population_size, size_t genome_size) {
+  for (size_t g = 0; g < 2; ++g) {
+    arenas_[g].resize(population_size * genome_size);
+    generations_[g].resize(population_size);
+    for (size_t i = 0; i < population_size; ++i) {
+      generations_[g][i].Bind_(arenas_[g].data() + i * genome_size, genome_size);
+    }
+  }
+}
+
+std::vector<Chromosome> &PopulationStore::GetCurrent() {
+  return generations_[current_];
+}
+
+const std::vector<Chromosome> &PopulationStore::GetCurrent() const {
+  return generations_[current_];
+}
+
+std::vector<Chromosome> &PopulationStore::GetNext() {
+  return generations_[current_ ^ 1];
+}
+
+void PopulationStore::Swap() {
+  current_ ^= 1;
+}
+
+Chromosome &PopulationStore::operator[](size_t idx) {
+  return generations_[current_][idx];
+}
+
+const Chromosome &PopulationStore::operator[](size_t idx) const {
+  return generations_[current_][idx];
+}
+
+size_t PopulationStore::GetSize() const {
+  return generations_[current_].size();
+}
@@ -0,0 +1,115 @@
+#include <Rasterizer.hpp>
+#include <Kernels.hpp>
+#include <Utils.hpp>
+#include <cmath>
+
+using namespace rasterizer_detail;
+
+namespace {
+
+inline uint32_t Div255(uint32_t x) {
+  // exact round(x / 255) for x in [0, 255 * 255]
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+inline uint8_t ToByte(float value) {
+  return static_cast<uint8_t>(std::lround(clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+}  // namespace
+
+bool Rect::IsEmpty() const {
+  return x0 >= x1 || y0 >= y1;
+}
+
+size_t Rect::Area() const {
+  return IsEmpty() ? 0 : static_cast<size_t>(x1 - x0) * (y1 - y0);
+}
+
+Rect Rect::Intersect(const Rect &other) const {
+  return {std::max(x0, other.x0), std::max(y0, other.y0), std::min(x1, other.x1), std::min(y1, other.y1)};
+}
+
+Rect Rect::Union(const Rect &other) const {
+  if (IsEmpty()) {
+    return other;
+  }
+  if (other.IsEmpty()) {
+    return *this;
+  }
+  return {std::min(x0, other.x0), std::min(y0, other.y0), std::max(x1, other.x1), std::max(y1, other.y1)};
+}
+
+bool SetupTriangle(const Triangle &tr, int width, int height, RasterTriangle &out) {
+  uint8_t alpha = ToByte(tr.color.a);
+  if (alpha == 0) {
+    return false;
+  }
+  for (int ch = 0; ch < 3; ++ch) {
+    out.src[ch] = Div255(ToByte(tr.color[ch]) * alpha);
+  }
+  out.src[3] = Div255(alpha * alpha);
+  out.inv_alpha = 255 - alpha;
+
+  // viewport transform in single precision like the GL pipeline, then snap to the subpixel grid
+  float half_width = width * 0.5f;
+  float half_height = height * 0.5f;
+  int64_t xs[3], ys[3];
+  for (int i = 0; i < 3; ++i) {
+    xs[i] = std::lrintf((tr.vs[i].x * half_width + half_width) * kSubpixel);
+    ys[i] = std::lrintf((tr.vs[i].y * half_height + half_height) * kSubpixel);
+  }
+  int64_t area = (xs[1] - xs[0]) * (ys[2] - ys[0]) - (ys[1] - ys[0]) * (xs[2] - xs[0]);
+  if (area == 0) {
+    return false;
+  }
+  if (area < 0) {
+    std::swap(xs[1], xs[2]);
+    std::swap(ys[1], ys[2]);
+  }
+  for (int i = 0; i < 3; ++i) {
+    int j = (i + 1) % 3;
+    out.a[i] = ys[i] - ys[j];
+    out.b[i] = xs[j] - xs[i];
+    out.c[i] = xs[i] * ys[j] - xs[j] * ys[i];
+    // pixels exactly on left and top edges belong to the triangle, the rest go to the neighbour
+    bool top_left = out.a[i] > 0 || (out.a[i] == 0 && out.b[i] < 0);
+    out.bias[i] = top_left ? 0 : 1;
+  }
+
+  // pixels whose centres lie within the extent of the triangle
+  int64_t min_x = std::min({xs[0], xs[1], xs[2]});
+  int64_t max_x = std::max({xs[0], xs[1], xs[2]});
+  int64_t min_y = std::min({ys[0], ys[1], ys[2]});
+  int64_t max_y = std::max({ys[0], ys[1], ys[2]});
+  out.bounds.x0 = static_cast<int>(std::max<int64_t>(0, CeilDiv(min_x - kSubpixel / 2, kSubpixel)));
+  out.bounds.x1 = static_cast<int>(std::min<int64_t>(width, FloorDiv(max_x - kSubpixel / 2, kSubpixel) + 1));
+  out.bounds.y0 = static_cast<int>(std::max<int64_t>(0, CeilDiv(min_y - kSubpixel / 2, kSubpixel)));
+  out.bounds.y1 = static_cast<int>(std::min<int64_t>(height, FloorDiv(max_y - kSubpixel / 2, kSubpixel) + 1));
+  return !out.bounds.IsEmpty();
+}
+
+void DrawTriangle(const RasterTriangle &tr, const Rect &clip, int width, uint8_t *pixels) {
+  ForEachSpan(tr, clip, [&](int row, int begin, int end) {
+    BlendSpan(pixels + 4 * (static_cast<size_t>(row) * width + begin), end - begin, tr.src, tr.inv_alpha);
+  });
+}
+
+Rect TriangleBounds(const Triangle &tr, int width, int height) {
+  RasterTriangle setup;
+  if (!SetupTriangle(tr, width, height, setup)) {
+    return Rect();
+  }
+  return setup.bounds;
+}
+
+void ClearPixels(const Rect &rect, int width, uint8_t *pixels) {
+  for (int row = rect.y0; row < rect.y1; ++row) {
+    uint8_t *p = pixels + 4 * (static_cast<size_t>(row) * width + rect.x0);
+    for (int x = rect.x0; x < rect.x1; ++x, p += 4) {
+      p[0] = p[1] = p[2] = 0;
+      p[3] = 255;
+    }
+  }
+}
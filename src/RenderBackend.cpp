@@ -0,0 +1,799 @@
+#include <RenderBackend.hpp>
+#include <Chromosome.hpp>
+#include <Rasterizer.hpp>
+#include <ThreadPool.hpp>
+#include <Utils.hpp>
+#include <plog/Log.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+const char *render_backend_names[3] = {"OpenGL", "Software", "OpenGL, layered"};
+
+RenderBackend::RenderBackend(int width, int height, size_t slots)
+    : width_(width), height_(height), slots_(slots), buffer_size_(4 * static_cast<size_t>(width) * height) {}
+
+void RenderBackend::DrawBatch(const std::vector<Chromosome> &chromosomes, size_t first_slot) {
+  for (size_t i = 0; i < chromosomes.size(); ++i) {
+    Draw(chromosomes[i], first_slot + i);
+  }
+}
+
+bool RenderBackend::DrawRegion(const Chromosome &, size_t, size_t, const Rect &) {
+  return false;
+}
+
+void RenderBackend::CopyRegion(size_t from, size_t to, const Rect &) {
+  CopySlot(from, to);
+}
+
+bool RenderBackend::RedrawRegion(const Chromosome &chromosome, size_t from, size_t slot, const Rect &rect) {
+  return DrawRegion(chromosome, from, slot, rect);
+}
+
+bool RenderBackend::CacheSlot(const Chromosome &, size_t) {
+  return false;
+}
+
+void RenderBackend::BeginReadPixels(size_t) {}
+
+const GLubyte *RenderBackend::EndReadPixels(size_t slot) {
+  return GetPixels(slot);
+}
+
+void RenderBackend::SetTarget(const GLubyte *, bool) {}
+
+bool RenderBackend::ComputeSquaredErrors(size_t, size_t, uint64_t *) {
+  return false;
+}
+
+bool RenderBackend::CanComputeSquaredErrors() const {
+  return false;
+}
+
+bool RenderBackend::IsThreadSafe() const {
+  return false;
+}
+
+int RenderBackend::GetWidth() const {
+  return width_;
+}
+
+int RenderBackend::GetHeight() const {
+  return height_;
+}
+
+namespace {
+
+const char *kVertexSource =
+    "#version 330 core\n"
+    "layout(location = 0) in vec2 position;\n"
+    "layout(location = 1) in vec4 color;\n"
+    "flat out vec4 triangle_color;\n"
+    "void main() {\n"
+    "  gl_Position = vec4(position, 0.0, 1.0);\n"
+    "  triangle_color = color;\n"
+    "}\n";
+
+const char *kLayeredVertexSource =
+    "#version 330 core\n"
+    "layout(location = 0) in vec2 position;\n"
+    "layout(location = 1) in vec4 color;\n"
+    "layout(location = 2) in int layer;\n"
+    "flat out vec4 vertex_color;\n"
+    "flat out int vertex_layer;\n"
+    "void main() {\n"
+    "  gl_Position = vec4(position, 0.0, 1.0);\n"
+    "  vertex_color = color;\n"
+    "  vertex_layer = layer;\n"
+    "}\n";
+
+const char *kLayeredGeometrySource =
+    "#version 330 core\n"
+    "layout(triangles) in;\n"
+    "layout(triangle_strip, max_vertices = 3) out;\n"
+    "flat in vec4 vertex_color[];\n"
+    "flat in int vertex_layer[];\n"
+    "flat out vec4 triangle_color;\n"
+    "void main() {\n"
+    "  for (int i = 0; i < 3; ++i) {\n"
+    "    gl_Position = gl_in[i].gl_Position;\n"
+    "    gl_Layer = vertex_layer[0];\n"
+    "    triangle_color = vertex_color[0];\n"
+    "    EmitVertex();\n"
+    "  }\n"
+    "  EndPrimitive();\n"
+    "}\n";
+
+const char *kFragmentSource =
+    "#version 330 core\n"
+    "flat in vec4 triangle_color;\n"
+    "out vec4 frag_color;\n"
+    "void main() {\n"
+    "  frag_color = triangle_color;\n"
+    "}\n";
+
+// one invocation per 4x4 pixels, every 16x16 workgroup writes the sum of its 64x64 block, which stays
+// below 2^32 even at the maximum error of 4 * 255^2 per pixel
+const char *kErrorSource =
+    "layout(local_size_x = 16, local_size_y = 16) in;\n"
+    "#ifdef LAYERED\n"
+    "layout(binding = 0) uniform sampler2DArray images;\n"
+    "#else\n"
+    "layout(binding = 0) uniform sampler2D images;\n"
+    "#endif\n"
+    "layout(binding = 1) uniform sampler2D target;\n"
+    "layout(std430, binding = 0) writeonly buffer Partials { uint partials[]; };\n"
+    "uniform int first_layer;\n"
+    "uniform uint first_output;\n"
+    "uniform uvec4 channel_mask;\n"
+    "shared uint sums[256];\n"
+    "void main() {\n"
+    "  ivec2 size = textureSize(target, 0);\n"
+    "  ivec2 origin = ivec2(gl_GlobalInvocationID.xy) * 4;\n"
+    "  uint se = 0u;\n"
+    "  for (int y = origin.y; y < min(origin.y + 4, size.y); ++y) {\n"
+    "    for (int x = origin.x; x < min(origin.x + 4, size.x); ++x) {\n"
+    "#ifdef LAYERED\n"
+    "      vec4 a = texelFetch(images, ivec3(x, y, first_layer + int(gl_WorkGroupID.z)), 0);\n"
+    "#else\n"
+    "      vec4 a = texelFetch(images, ivec2(x, y), 0);\n"
+    "#endif\n"
+    "      vec4 b = texelFetch(target, ivec2(x, y), 0);\n"
+    "      uvec4 d = uvec4(abs(ivec4(round(a * 255.0)) - ivec4(round(b * 255.0)))) * channel_mask;\n"
+    "      se += d.r * d.r + d.g * d.g + d.b * d.b + d.a * d.a;\n"
+    "    }\n"
+    "  }\n"
+    "  uint local = gl_LocalInvocationIndex;\n"
+    "  sums[local] = se;\n"
+    "  barrier();\n"
+    "  for (uint stride = 128u; stride > 0u; stride >>= 1) {\n"
+    "    if (local < stride) {\n"
+    "      sums[local] += sums[local + stride];\n"
+    "    }\n"
+    "    barrier();\n"
+    "  }\n"
+    "  if (local == 0u) {\n"
+    "    uint groups = gl_NumWorkGroups.x * gl_NumWorkGroups.y;\n"
+    "    uint group = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;\n"
+    "    partials[(first_output + gl_WorkGroupID.z) * groups + group] = sums[0];\n"
+    "  }\n"
+    "}\n";
+
+// one workgroup per individual adds up its partial sums in 64 bits
+const char *kSumSource =
+    "#version 430\n"
+    "layout(local_size_x = 256) in;\n"
+    "layout(std430, binding = 0) readonly buffer Partials { uint partials[]; };\n"
+    "layout(std430, binding = 1) writeonly buffer Errors { uvec2 errors[]; };\n"
+    "uniform uint groups;\n"
+    "shared uvec2 sums[256];\n"
+    "uvec2 Add(uvec2 a, uvec2 b) {\n"
+    "  uint carry;\n"
+    "  uint low = uaddCarry(a.x, b.x, carry);\n"
+    "  return uvec2(low, a.y + b.y + carry);\n"
+    "}\n"
+    "void main() {\n"
+    "  uint local = gl_LocalInvocationIndex;\n"
+    "  uint base = gl_WorkGroupID.x * groups;\n"
+    "  uvec2 sum = uvec2(0u);\n"
+    "  for (uint i = local; i < groups; i += 256u) {\n"
+    "    sum = Add(sum, uvec2(partials[base + i], 0u));\n"
+    "  }\n"
+    "  sums[local] = sum;\n"
+    "  barrier();\n"
+    "  for (uint stride = 128u; stride > 0u; stride >>= 1) {\n"
+    "    if (local < stride) {\n"
+    "      sums[local] = Add(sums[local], sums[local + stride]);\n"
+    "    }\n"
+    "    barrier();\n"
+    "  }\n"
+    "  if (local == 0u) {\n"
+    "    errors[gl_WorkGroupID.x] = sums[0];\n"
+    "  }\n"
+    "}\n";
+
+// pixels per side of the block summed by one workgroup
+const GLuint kErrorBlock = 64;
+
+}  // namespace
+
+OpenGLRenderBackend::OpenGLRenderBackend(int width, int height, size_t slots, bool layered)
+    : RenderBackend(width, height, slots),
+      layered_(layered && (GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 5))),
+      pixels_(buffer_size_) {
+  if (layered && !layered_) {
+    PLOGW << "Layered rendering needs GL 4.5, drawing slots one by one";
+  }
+  SetupBuffers_();
+}
+
+OpenGLRenderBackend::~OpenGLRenderBackend() {
+  PLOGI << "Deleting buffers for backend " << this;
+  glDeleteFramebuffers(buffers_.size(), buffers_.data());
+  for (GLuint texture : textures_) {
+    if (texture != 0) {
+      glDeleteTextures(1, &texture);
+    }
+  }
+  if (array_texture_ != 0) {
+    glDeleteTextures(1, &array_texture_);
+  }
+  if (program_ != 0) {
+    for (GLsync fence : fences_) {
+      if (fence != nullptr) {
+        glDeleteSync(fence);
+      }
+    }
+    glDeleteBuffers(1, &vertex_buffer_);
+    glDeleteVertexArrays(1, &vertex_array_);
+    glDeleteProgram(program_);
+  }
+  if (error_program_ != 0) {
+    glDeleteProgram(error_program_);
+    glDeleteProgram(sum_program_);
+    glDeleteBuffers(1, &partial_buffer_);
+    glDeleteBuffers(1, &error_buffer_);
+  }
+  if (target_texture_ != 0) {
+    glDeleteTextures(1, &target_texture_);
+  }
+  for (auto &readback : readbacks_) {
+    if (readback.fence != nullptr) {
+      glDeleteSync(readback.fence);
+    }
+    glDeleteBuffers(1, &readback.buffer);
+  }
+}
+
+void OpenGLRenderBackend::Draw(const Chromosome &chromosome, size_t slot) {
+  if (layered_) {
+    ClearLayers_(slot, 1);
+    glBindFramebuffer(GL_FRAMEBUFFER, buffers_[0]);
+    glViewport(0, 0, width_, height_);
+    DrawBatched_(&chromosome, 1, slot);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, buffers_[slot]);
+  glViewport(0, 0, width_, height_);
+  glClear(GL_COLOR_BUFFER_BIT);
+  if (program_ != 0) {
+    DrawBatched_(&chromosome, 1, 0);
+  } else {
+    DrawImmediate_(chromosome);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void OpenGLRenderBackend::DrawBatch(const std::vector<Chromosome> &chromosomes, size_t first_slot) {
+  if (!layered_) {
+    RenderBackend::DrawBatch(chromosomes, first_slot);
+    return;
+  }
+  ClearLayers_(first_slot, chromosomes.size());
+  glBindFramebuffer(GL_FRAMEBUFFER, buffers_[0]);
+  glViewport(0, 0, width_, height_);
+  DrawBatched_(chromosomes.data(), chromosomes.size(), first_slot);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void OpenGLRenderBackend::DrawImmediate_(const Chromosome &chromosome) {
+  glBegin(GL_TRIANGLES);
+  for (const auto &tr : chromosome.GetTriangles()) {
+    glColor4f(tr.color.r, tr.color.g, tr.color.b, tr.color.a);
+    for (int i = 0; i < 3; ++i) {
+      glVertex2f(tr.vs[i].x, tr.vs[i].y);
+    }
+  }
+  glEnd();
+}
+
+void OpenGLRenderBackend::DrawBatched_(const Chromosome *chromosomes, size_t count, size_t first_layer) {
+  size_t vertex_count = 0;
+  for (size_t k = 0; k < count; ++k) {
+    vertex_count += 3 * chromosomes[k].GetTriangles().size();
+  }
+  if (vertex_count == 0) {
+    return;
+  }
+  ReserveVertices_(vertex_count);
+
+  GLint first = 0;
+  Vertex *out;
+  if (mapped_ != nullptr) {
+    // wait until the GPU is done with the draw that used this region kRegions draws ago
+    region_ = (region_ + 1) % kRegions;
+    if (fences_[region_] != nullptr) {
+      glClientWaitSync(fences_[region_], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+      glDeleteSync(fences_[region_]);
+      fences_[region_] = nullptr;
+    }
+    first = static_cast<GLint>(region_ * region_vertices_);
+    out = mapped_ + first;
+  } else {
+    out = vertices_.data();
+  }
+  for (size_t k = 0; k < count; ++k) {
+    GLint layer = static_cast<GLint>(first_layer + k);
+    for (const auto &tr : chromosomes[k].GetTriangles()) {
+      for (int i = 0; i < 3; ++i) {
+        *out++ = {tr.vs[i].x, tr.vs[i].y, tr.color.r, tr.color.g, tr.color.b, tr.color.a, layer};
+      }
+    }
+  }
+  if (mapped_ == nullptr) {
+    // orphan the old storage so the driver does not have to wait for the previous draw
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+    glBufferData(GL_ARRAY_BUFFER, region_vertices_ * sizeof(Vertex), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertex_count * sizeof(Vertex), vertices_.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  glUseProgram(program_);
+  glBindVertexArray(vertex_array_);
+  glDrawArrays(GL_TRIANGLES, first, static_cast<GLsizei>(vertex_count));
+  glBindVertexArray(0);
+  glUseProgram(0);
+  if (mapped_ != nullptr) {
+    fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+}
+
+void OpenGLRenderBackend::ClearLayers_(size_t first, size_t count) {
+  const GLubyte black[4] = {0, 0, 0, 255};
+  glClearTexSubImage(array_texture_, 0, 0, 0, first, width_, height_, count, GL_RGBA, GL_UNSIGNED_BYTE, black);
+}
+
+void OpenGLRenderBackend::ReserveVertices_(size_t count) {
+  if (count <= region_vertices_) {
+    return;
+  }
+  // (re)create the buffer big enough for count vertices per region, attribute bindings go with it
+  for (GLsync &fence : fences_) {
+    if (fence != nullptr) {
+      glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+  if (vertex_buffer_ != 0) {
+    glDeleteBuffers(1, &vertex_buffer_);
+  }
+  region_vertices_ = count;
+  glGenBuffers(1, &vertex_buffer_);
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+  if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) {
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLsizeiptr size = kRegions * region_vertices_ * sizeof(Vertex);
+    glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+    mapped_ = static_cast<Vertex *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+  } else {
+    glBufferData(GL_ARRAY_BUFFER, region_vertices_ * sizeof(Vertex), NULL, GL_STREAM_DRAW);
+    vertices_.resize(region_vertices_);
+  }
+  glBindVertexArray(vertex_array_);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, x));
+  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, r));
+  glVertexAttribIPointer(2, 1, GL_INT, sizeof(Vertex), (void *)offsetof(Vertex, layer));
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  if (layered_) {
+    glEnableVertexAttribArray(2);
+  }
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+const GLubyte *OpenGLRenderBackend::GetPixels(size_t slot) {
+  ReadPixels(slot, pixels_.data());
+  return pixels_.data();
+}
+
+void OpenGLRenderBackend::ReadPixels(size_t slot, GLubyte *pixels) {
+  if (layered_) {
+    glGetTextureSubImage(array_texture_, 0, 0, 0, slot, width_, height_, 1, GL_RGBA, GL_UNSIGNED_BYTE, buffer_size_,
+                         pixels);
+  } else {
+    glGetTextureImage(textures_[slot], 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer_size_, pixels);
+  }
+}
+
+void OpenGLRenderBackend::BeginReadPixels(size_t slot) {
+  if (readbacks_.empty()) {
+    return;
+  }
+  Readback &readback = readbacks_[begun_reads_++ % readbacks_.size()];
+  if (readback.mapped) {
+    glUnmapNamedBuffer(readback.buffer);
+    readback.mapped = false;
+  }
+  // with a pack buffer bound the pixels pointer is an offset into it and the call returns immediately
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+  ReadPixels(slot, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+const GLubyte *OpenGLRenderBackend::EndReadPixels(size_t slot) {
+  if (readbacks_.empty()) {
+    return GetPixels(slot);
+  }
+  Readback &readback = readbacks_[ended_reads_++ % readbacks_.size()];
+  glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+  glDeleteSync(readback.fence);
+  readback.fence = nullptr;
+  readback.mapped = true;
+  return static_cast<const GLubyte *>(glMapNamedBufferRange(readback.buffer, 0, buffer_size_, GL_MAP_READ_BIT));
+}
+
+void OpenGLRenderBackend::CopySlot(size_t from, size_t to) {
+  if (layered_) {
+    glCopyImageSubData(array_texture_, GL_TEXTURE_2D_ARRAY, 0, 0, 0, from, array_texture_, GL_TEXTURE_2D_ARRAY, 0, 0,
+                       0, to, width_, height_, 1);
+  } else {
+    glBlitNamedFramebuffer(buffers_[from], buffers_[to], 0, 0, width_, height_, 0, 0, width_, height_,
+                           GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  }
+}
+
+void OpenGLRenderBackend::SetTarget(const GLubyte *pixels, bool skip_alpha) {
+  skip_alpha_ = skip_alpha;
+  if (error_program_ == 0) {
+    return;
+  }
+  if (target_texture_ == 0) {
+    glCreateTextures(GL_TEXTURE_2D, 1, &target_texture_);
+    glTextureStorage2D(target_texture_, 1, GL_RGBA8, width_, height_);
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glTextureSubImage2D(target_texture_, 0, 0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+}
+
+bool OpenGLRenderBackend::ComputeSquaredErrors(size_t first_slot, size_t count, uint64_t *errors) {
+  if (!CanComputeSquaredErrors()) {
+    return false;
+  }
+  GLuint groups_x = (width_ + kErrorBlock - 1) / kErrorBlock;
+  GLuint groups_y = (height_ + kErrorBlock - 1) / kErrorBlock;
+  GLuint groups = groups_x * groups_y;
+  if (count > error_capacity_) {
+    error_capacity_ = count;
+    glNamedBufferData(partial_buffer_, count * groups * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+    glNamedBufferData(error_buffer_, count * 2 * sizeof(GLuint), NULL, GL_DYNAMIC_READ);
+  }
+
+  glUseProgram(error_program_);
+  glUniform4ui(glGetUniformLocation(error_program_, "channel_mask"), 1, 1, 1, skip_alpha_ ? 0 : 1);
+  glBindTextureUnit(1, target_texture_);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, partial_buffer_);
+  GLint first_layer = glGetUniformLocation(error_program_, "first_layer");
+  GLint first_output = glGetUniformLocation(error_program_, "first_output");
+  if (layered_) {
+    glBindTextureUnit(0, array_texture_);
+    glUniform1i(first_layer, static_cast<GLint>(first_slot));
+    glUniform1ui(first_output, 0);
+    glDispatchCompute(groups_x, groups_y, count);
+  } else {
+    for (size_t k = 0; k < count; ++k) {
+      glBindTextureUnit(0, textures_[first_slot + k]);
+      glUniform1ui(first_output, static_cast<GLuint>(k));
+      glDispatchCompute(groups_x, groups_y, 1);
+    }
+  }
+  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+  glUseProgram(sum_program_);
+  glUniform1ui(glGetUniformLocation(sum_program_, "groups"), groups);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, error_buffer_);
+  glDispatchCompute(count, 1, 1);
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+  glUseProgram(0);
+  glBindTextureUnit(0, 0);
+  glBindTextureUnit(1, 0);
+
+  sums_.resize(2 * count);
+  glGetNamedBufferSubData(error_buffer_, 0, sums_.size() * sizeof(GLuint), sums_.data());
+  for (size_t k = 0; k < count; ++k) {
+    errors[k] = static_cast<uint64_t>(sums_[2 * k + 1]) << 32 | sums_[2 * k];
+  }
+  return true;
+}
+
+bool OpenGLRenderBackend::CanComputeSquaredErrors() const {
+  return error_program_ != 0 && target_texture_ != 0;
+}
+
+GLuint OpenGLRenderBackend::GetTexture(size_t slot) {
+  if (layered_ && textures_[slot] == 0) {
+    glGenTextures(1, &textures_[slot]);
+    glTextureView(textures_[slot], GL_TEXTURE_2D, array_texture_, GL_RGBA8, 0, 1, slot, 1);
+  }
+  return textures_[slot];
+}
+
+void OpenGLRenderBackend::SetupBuffers_() {
+  PLOGI << "Setting up buffers for backend " << this;
+  if (layered_) {
+    SetupLayeredBuffers_();
+  } else {
+    buffers_.resize(slots_);
+    textures_.resize(slots_);
+    glGenFramebuffers(slots_, buffers_.data());
+    glGenTextures(slots_, textures_.data());
+
+    for (size_t i = 0; i < slots_; ++i) {
+      glBindFramebuffer(GL_FRAMEBUFFER, buffers_[i]);
+      glBindTexture(GL_TEXTURE_2D, textures_[i]);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textures_[i], 0);
+      GLenum DrawBuffers[1] = {GL_COLOR_ATTACHMENT0};
+      glDrawBuffers(1, DrawBuffers);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  if (GLVersion.major > 3 || (GLVersion.major == 3 && GLVersion.minor >= 3)) {
+    if (!SetupProgram_()) {
+      PLOGW << "Falling back to immediate mode drawing";
+    }
+  }
+  if (GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 5)) {
+    if (!SetupErrorPrograms_()) {
+      PLOGW << "Falling back to scoring read back pixels";
+    }
+    readbacks_.resize(kReadAhead + 1);
+    for (auto &readback : readbacks_) {
+      glCreateBuffers(1, &readback.buffer);
+      glNamedBufferStorage(readback.buffer, buffer_size_, NULL, GL_MAP_READ_BIT);
+    }
+  }
+}
+
+void OpenGLRenderBackend::SetupLayeredBuffers_() {
+  // immutable storage so every layer can get a 2D view for display
+  glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &array_texture_);
+  glTextureStorage3D(array_texture_, 1, GL_RGBA8, width_, height_, slots_);
+  glTextureParameteri(array_texture_, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTextureParameteri(array_texture_, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  textures_.assign(slots_, 0);
+
+  buffers_.resize(1);
+  glCreateFramebuffers(1, buffers_.data());
+  glNamedFramebufferTexture(buffers_[0], GL_COLOR_ATTACHMENT0, array_texture_, 0);
+  glNamedFramebufferDrawBuffer(buffers_[0], GL_COLOR_ATTACHMENT0);
+}
+
+bool OpenGLRenderBackend::SetupErrorPrograms_() {
+  std::string error_source = std::string("#version 430\n") + (layered_ ? "#define LAYERED\n" : "") + kErrorSource;
+  GLuint error_shader = CompileShader(GL_COMPUTE_SHADER, error_source.c_str());
+  GLuint sum_shader = CompileShader(GL_COMPUTE_SHADER, kSumSource);
+  if (error_shader != 0 && sum_shader != 0) {
+    error_program_ = LinkProgram({error_shader});
+    sum_program_ = LinkProgram({sum_shader});
+  }
+  glDeleteShader(error_shader);
+  glDeleteShader(sum_shader);
+  if (error_program_ == 0 || sum_program_ == 0) {
+    glDeleteProgram(error_program_);
+    glDeleteProgram(sum_program_);
+    error_program_ = sum_program_ = 0;
+    return false;
+  }
+  glCreateBuffers(1, &partial_buffer_);
+  glCreateBuffers(1, &error_buffer_);
+  return true;
+}
+
+bool OpenGLRenderBackend::SetupProgram_() {
+  GLuint vertex_shader = CompileShader(GL_VERTEX_SHADER, layered_ ? kLayeredVertexSource : kVertexSource);
+  GLuint geometry_shader = layered_ ? CompileShader(GL_GEOMETRY_SHADER, kLayeredGeometrySource) : 0;
+  GLuint fragment_shader = CompileShader(GL_FRAGMENT_SHADER, kFragmentSource);
+  GLuint program = 0;
+  if (vertex_shader != 0 && fragment_shader != 0 && (!layered_ || geometry_shader != 0)) {
+    program = layered_ ? LinkProgram({vertex_shader, geometry_shader, fragment_shader})
+                       : LinkProgram({vertex_shader, fragment_shader});
+  }
+  glDeleteShader(vertex_shader);
+  glDeleteShader(geometry_shader);
+  glDeleteShader(fragment_shader);
+  if (program == 0) {
+    return false;
+  }
+  program_ = program;
+  glGenVertexArrays(1, &vertex_array_);
+  PLOGI << "Drawing with a vertex buffer and shader program " << program_ << (layered_ ? ", layered" : "");
+  return true;
+}
+
+SoftwareRenderBackend::SoftwareRenderBackend(int width, int height, size_t slots, ThreadPool *pool)
+    : RenderBackend(width, height, slots),
+      pool_(pool),
+      tiles_x_((width + kTileWidth - 1) / kTileWidth),
+      tiles_y_((height + kTileHeight - 1) / kTileHeight),
+      bins_(tiles_x_ * tiles_y_),
+      pixels_(slots, std::vector<GLubyte>(buffer_size_)),
+      textures_(slots, -1),
+      dirty_(slots, true),
+      mirror_textures_(GLVersion.major > 0) {}
+
+SoftwareRenderBackend::~SoftwareRenderBackend() {
+  for (GLuint texture : textures_) {
+    if (texture != static_cast<GLuint>(-1)) {
+      glDeleteTextures(1, &texture);
+    }
+  }
+}
+
+void SoftwareRenderBackend::Draw(const Chromosome &chromosome, size_t slot) {
+  GLubyte *pixels = pixels_[slot].data();
+  if (pool_ != nullptr && pool_->GetThreadCount() > 1 && !ThreadPool::InTask() && bins_.size() > 1) {
+    DrawTiled_(chromosome, pixels);
+  } else {
+    Rect image = {0, 0, width_, height_};
+    ClearPixels(image, width_, pixels);
+    RasterTriangle setup;
+    for (const auto &tr : chromosome.GetTriangles()) {
+      if (SetupTriangle(tr, width_, height_, setup)) {
+        DrawTriangle(setup, image, width_, pixels);
+      }
+    }
+  }
+  Overwrite_(slot);
+}
+
+bool SoftwareRenderBackend::DrawRegion(const Chromosome &chromosome, size_t from, size_t slot, const Rect &rect) {
+  GLubyte *pixels = pixels_[slot].data();
+  if (from != slot) {
+    std::memcpy(pixels, pixels_[from].data(), buffer_size_);
+  }
+  Recomposite_(chromosome, from, slot, rect);
+  return true;
+}
+
+bool SoftwareRenderBackend::RedrawRegion(const Chromosome &chromosome, size_t from, size_t slot, const Rect &rect) {
+  Recomposite_(chromosome, from, slot, rect);
+  return true;
+}
+
+void SoftwareRenderBackend::Recomposite_(const Chromosome &chromosome, size_t from, size_t slot, const Rect &rect) {
+  GLubyte *pixels = pixels_[slot].data();
+  Rect clip = rect.Intersect({0, 0, width_, height_});
+  const auto &changes = chromosome.GetChanges();
+  if (from == cache_slot_.load(std::memory_order_relaxed) && from != slot && !changes.empty()) {
+    size_t lo = changes[0].index;
+    size_t hi = lo;
+    for (const auto &change : changes) {
+      lo = std::min(lo, change.index);
+      hi = std::max(hi, change.index);
+    }
+    cache_.Draw(chromosome, lo, hi, clip, pixels);
+  } else {
+    ClearPixels(clip, width_, pixels);
+    RasterTriangle setup;
+    for (const auto &tr : chromosome.GetTriangles()) {
+      if (SetupTriangle(tr, width_, height_, setup) && !setup.bounds.Intersect(clip).IsEmpty()) {
+        DrawTriangle(setup, clip, width_, pixels);
+      }
+    }
+  }
+  Overwrite_(slot);
+}
+
+bool SoftwareRenderBackend::CacheSlot(const Chromosome &chromosome, size_t slot) {
+  cache_slot_ = Chromosome::kNoSlot;
+  if (!cache_.Build(chromosome, width_, height_, pool_)) {
+    return false;
+  }
+  cache_slot_ = slot;
+  return true;
+}
+
+void SoftwareRenderBackend::DrawTiled_(const Chromosome &chromosome, GLubyte *pixels) {
+  // bin triangles into every tile their bounding box touches, keeping genome order within a bin
+  const auto &triangles = chromosome.GetTriangles();
+  setups_.resize(triangles.size());
+  for (auto &bin : bins_) {
+    bin.clear();
+  }
+  for (size_t i = 0; i < triangles.size(); ++i) {
+    RasterTriangle &setup = setups_[i];
+    if (!SetupTriangle(triangles[i], width_, height_, setup)) {
+      continue;
+    }
+    int tx1 = (setup.bounds.x1 - 1) / kTileWidth;
+    int ty1 = (setup.bounds.y1 - 1) / kTileHeight;
+    for (int ty = setup.bounds.y0 / kTileHeight; ty <= ty1; ++ty) {
+      for (int tx = setup.bounds.x0 / kTileWidth; tx <= tx1; ++tx) {
+        bins_[ty * tiles_x_ + tx].push_back(i);
+      }
+    }
+  }
+
+  // tiles do not share pixels, so each one can be composited on its own thread
+  pool_->ParallelFor(bins_.size(), [&](size_t tile, size_t) {
+    int tx = tile % tiles_x_;
+    int ty = tile / tiles_x_;
+    Rect rect = {tx * kTileWidth, ty * kTileHeight, std::min(width_, (tx + 1) * kTileWidth),
+                 std::min(height_, (ty + 1) * kTileHeight)};
+    ClearPixels(rect, width_, pixels);
+    for (uint32_t idx : bins_[tile]) {
+      DrawTriangle(setups_[idx], rect, width_, pixels);
+    }
+  });
+}
+
+const GLubyte *SoftwareRenderBackend::GetPixels(size_t slot) {
+  return pixels_[slot].data();
+}
+
+void SoftwareRenderBackend::ReadPixels(size_t slot, GLubyte *pixels) {
+  std::memcpy(pixels, pixels_[slot].data(), buffer_size_);
+}
+
+bool SoftwareRenderBackend::IsThreadSafe() const {
+  return true;
+}
+
+void SoftwareRenderBackend::CopySlot(size_t from, size_t to) {
+  std::memcpy(pixels_[to].data(), pixels_[from].data(), buffer_size_);
+  Overwrite_(to);
+}
+
+void SoftwareRenderBackend::CopyRegion(size_t from, size_t to, const Rect &rect) {
+  Rect clip = rect.Intersect({0, 0, width_, height_});
+  for (int row = clip.y0; row < clip.y1; ++row) {
+    size_t offset = 4 * (static_cast<size_t>(row) * width_ + clip.x0);
+    std::memcpy(pixels_[to].data() + offset, pixels_[from].data() + offset, 4 * static_cast<size_t>(clip.x1 - clip.x0));
+  }
+  Overwrite_(to);
+}
+
+GLuint SoftwareRenderBackend::GetTexture(size_t slot) {
+  if (!mirror_textures_) {
+    return -1;
+  }
+  if (dirty_[slot]) {
+    UploadTexture_(slot);
+  }
+  return textures_[slot];
+}
+
+void SoftwareRenderBackend::UploadTexture_(size_t slot) {
+  if (textures_[slot] == static_cast<GLuint>(-1)) {
+    glGenTextures(1, &textures_[slot]);
+    glBindTexture(GL_TEXTURE_2D, textures_[slot]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  }
+  glTextureSubImage2D(textures_[slot], 0, 0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, pixels_[slot].data());
+  dirty_[slot] = false;
+}
+
+void SoftwareRenderBackend::Overwrite_(size_t slot) {
+  dirty_[slot] = true;
+  if (cache_slot_.load(std::memory_order_relaxed) == slot) {
+    cache_slot_ = Chromosome::kNoSlot;
+  }
+}
+
+RenderBackend *CreateRenderBackend(RenderBackendType type, int width, int height, size_t slots, ThreadPool *pool) {
+  switch (type) {
+    case OPENGL: {
+      return new OpenGLRenderBackend(width, height, slots);
+    }
+    case OPENGL_LAYERED: {
+      return new OpenGLRenderBackend(width, height, slots, true);
+    }
+    case SOFTWARE: {
+      return new SoftwareRenderBackend(width, height, slots, pool);
+    }
+  }
+  return nullptr;
+}
@@ -0,0 +1,37 @@
+#include <Rng.hpp>
+#include <random>
+
+namespace {
+
+uint64_t SplitMix64(uint64_t &x) {
+  uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+}  // namespace
+
+uint64_t RandomSeed() {
+  std::random_device device;
+  uint64_t seed = 0;
+  while (seed == 0) {
+    seed = (static_cast<uint64_t>(device()) << 32) | device();
+  }
+  return seed;
+}
+
+Rng::Rng(uint64_t seed, uint64_t stream) {
+  // hash the stream first so neighbouring streams start from unrelated states
+  uint64_t key = stream;
+  uint64_t x = seed ^ SplitMix64(key);
+  for (auto &s : s_) {
+    s = SplitMix64(x);
+  }
+}
+
+void Rng::Fill(float *values, size_t count, float from, float to) {
+  for (size_t i = 0; i < count; ++i) {
+    values[i] = Float(from, to);
+  }
+}
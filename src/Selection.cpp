@@ -2,51 +2,103 @@
 #include <Chromosome.hpp>
 #include <Utils.hpp>
 #include <vector>
-#include <stdexcept>
+#include <algorithm>
+#include <numeric>
 
 const char *selection_type_names[4] = {"Fitness Proportionate Selection", "Stochastic Universal Sampling",
                                        "Tournament Selection", "Truncation Selection"};
 
 SelectionStrategy::SelectionStrategy(float cleansing_rate) : cleansing_rate_(cleansing_rate) {}
 
-std::vector<Chromosome> FitnessPropotionateSelection::operator()(const std::vector<Chromosome> &chromosomes) {
-  size_t size = chromosomes.size();
-  std::vector<float> normalized_fitness(size);
-  std::vector<float> acc_fitness(size);
-  float total_fitness = 0;
-  for (size_t i = 0; i < size; ++i) {
+// in double so tens of thousands of them still add up exactly enough
+void SelectionStrategy::AccumulateFitness_(const std::vector<Chromosome> &chromosomes) {
+  acc_fitness_.resize(chromosomes.size());
+  double total_fitness = 0;
+  for (size_t i = 0; i < chromosomes.size(); ++i) {
     total_fitness += chromosomes[i].GetFitness();
-    acc_fitness[i] = total_fitness;
-  }
-  for (auto &fitness : acc_fitness) {
-    fitness /= total_fitness;
+    acc_fitness_[i] = total_fitness;
   }
-  size_t keep = size * (1 - cleansing_rate_);
-  std::vector<Chromosome> new_chromosomes;
+}
+
+size_t SelectionStrategy::Keep_(size_t size) const {
+  return std::min(size, std::max<size_t>(1, size * (1 - cleansing_rate_)));
+}
+
+namespace {
+
+// contestants per tournament, each pick is the fittest of this many individuals drawn with replacement
+const size_t kTournamentSize = 3;
+
+}  // namespace
+
+void FitnessPropotionateSelection::operator()(const std::vector<Chromosome> &chromosomes, Rng &rng,
+                                              std::vector<size_t> &parents) {
+  size_t size = chromosomes.size();
+  AccumulateFitness_(chromosomes);
+  double total_fitness = acc_fitness_.back();
+  size_t keep = Keep_(size);
+  parents.clear();
   for (size_t i = 0; i < keep; ++i) {
-    float r = rand_float();
-    size_t j = 0;
-    while (r > acc_fitness[j]) {
+    // first individual whose running sum passes the spin
+    double r = rng.Float() * total_fitness;
+    size_t j = std::upper_bound(acc_fitness_.begin(), acc_fitness_.end(), r) - acc_fitness_.begin();
+    parents.push_back(std::min(j, size - 1));
+  }
+}
+
+void StochasticUniversalSampling::operator()(const std::vector<Chromosome> &chromosomes, Rng &rng,
+                                             std::vector<size_t> &parents) {
+  size_t size = chromosomes.size();
+  AccumulateFitness_(chromosomes);
+  size_t keep = Keep_(size);
+  parents.clear();
+  if (keep == 0) {
+    return;
+  }
+  // one spin with keep equally spaced pointers, walked together with the running sums in a single pass
+  double step = acc_fitness_.back() / keep;
+  double pointer = rng.Float() * step;
+  size_t j = 0;
+  for (size_t i = 0; i < keep; ++i, pointer += step) {
+    while (j + 1 < size && acc_fitness_[j] <= pointer) {
       ++j;
     }
-    new_chromosomes.emplace_back(chromosomes[j]);
+    parents.push_back(j);
   }
-  return std::move(new_chromosomes);
 }
 
-std::vector<Chromosome> StochasticUniversalSampling::operator()(const std::vector<Chromosome> &chromosomes) {
-  throw std::logic_error("Function not implemented");
+void TournamentSelection::operator()(const std::vector<Chromosome> &chromosomes, Rng &rng,
+                                     std::vector<size_t> &parents) {
+  size_t size = chromosomes.size();
+  size_t keep = Keep_(size);
+  parents.clear();
+  for (size_t i = 0; i < keep; ++i) {
+    parents.push_back(Pick(chromosomes, rng));
+  }
 }
 
-std::vector<Chromosome> TournamentSelection::operator()(const std::vector<Chromosome> &chromosomes) {
-  throw std::logic_error("Function not implemented");
+size_t TournamentSelection::Pick(const std::vector<Chromosome> &chromosomes, Rng &rng) const {
+  size_t size = chromosomes.size();
+  size_t winner = rng.Below(size);
+  for (size_t k = 1; k < kTournamentSize; ++k) {
+    size_t contestant = rng.Below(size);
+    if (chromosomes[contestant].GetFitness() > chromosomes[winner].GetFitness()) {
+      winner = contestant;
+    }
+  }
+  return winner;
 }
 
-std::vector<Chromosome> TruncationSelection::operator()(const std::vector<Chromosome> &chromosomes) {
-  std::vector<Chromosome> new_chromosomes(chromosomes.begin(), chromosomes.end());
-  std::sort(new_chromosomes.begin(), new_chromosomes.end(),
-            [](const Chromosome &a, const Chromosome &b) { return a.GetFitness() > b.GetFitness(); });
-  size_t keep = chromosomes.size() * (1 - cleansing_rate_);
-  new_chromosomes.resize(keep);
-  return std::move(new_chromosomes);
+void TruncationSelection::operator()(const std::vector<Chromosome> &chromosomes, Rng &,
+                                     std::vector<size_t> &parents) {
+  parents.resize(chromosomes.size());
+  std::iota(parents.begin(), parents.end(), 0);
+  size_t keep = Keep_(chromosomes.size());
+  // the survivors only have to be the best, not in order
+  std::nth_element(parents.begin(), parents.begin() + keep, parents.end(), [&chromosomes](size_t a, size_t b) {
+    return chromosomes[a].GetFitness() > chromosomes[b].GetFitness();
+  });
+  parents.resize(keep);
+  // a fixed order for the same survivors, however the rest of the population compares
+  std::sort(parents.begin(), parents.end());
 }
\ No newline at end of file
@@ -1,39 +1,97 @@
 #include <Solver.hpp>
 #include <Chromosome.hpp>
+#include <Fitness.hpp>
 #include <Utils.hpp>
+#include <ThreadPool.hpp>
+#include <Rasterizer.hpp>
 #include <plog/Log.h>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <numeric>
 
-Solver::Solver(Image image, size_t population_size, size_t chromosome_size, float cleansing_rate,
-               CrossoverType crossover_type, SelectionType selection_type)
-    : image_(image),
-      population_size_(population_size),
-      chromosome_size_(chromosome_size),
-      initialized_(true),
-      buffers_(population_size),
-      textures_(population_size),
-      buffer_size_(4 * image.width * image.height),
-      cur_pixels_(std::make_unique<GLubyte[]>(buffer_size_)),
-      img_pixels_(std::make_unique<GLubyte[]>(buffer_size_)) {
-  switch (crossover_type) {
-    case ONE_POINT: {
-      Crossover_ = new OnePointCrossoverStrategy();
-      break;
+namespace {
+
+// the racing proxy is this many pyramid levels below the level being scored
+const size_t kProxyLevels = 2;
+// weight of a new sample in the proxy calibration once the first samples are averaged in
+const double kRacingDecay = 0.02;
+// rows per chunk of an early-abort scan
+const int kScanBand = 16;
+
+// x with P(Z <= x) = p for a standard normal Z, by bisection on erfc
+double NormalQuantile(double p) {
+  double lo = -10.0;
+  double hi = 10.0;
+  for (int i = 0; i < 100; ++i) {
+    double mid = (lo + hi) / 2;
+    if (0.5 * std::erfc(-mid / std::sqrt(2.0)) < p) {
+      lo = mid;
+    } else {
+      hi = mid;
     }
-    case TWO_POINT: {
-      Crossover_ = new TwoPointCrossoverStrategy();
-      break;
+  }
+  return (lo + hi) / 2;
+}
+
+}  // namespace
+
+// survival cutoff of one evaluation, the survivors_-th smallest squared error of the children scored in full.
+// One lives as long as the solver and is reset for every evaluation, so its buffers are reused
+struct Solver::Cutoff {
+  void Reset(size_t survivors, size_t bands) {
+    value.store(UINT64_MAX, std::memory_order_relaxed);
+    errors.clear();
+    errors.reserve(survivors + 1);
+    best = UINT64_MAX;
+    best_bands.resize(bands);
+  }
+
+  void Add(uint64_t se, size_t survivors, const uint64_t *bands) {
+    std::lock_guard<std::mutex> lock(mutex);
+    // a max heap of the smallest errors so far
+    errors.push_back(se);
+    std::push_heap(errors.begin(), errors.end());
+    if (errors.size() > survivors) {
+      std::pop_heap(errors.begin(), errors.end());
+      errors.pop_back();
     }
-    case UNIFORM: {
-      Crossover_ = new UniformCrossoverStrategy();
-      break;
+    if (errors.size() == survivors) {
+      value.store(errors.front(), std::memory_order_relaxed);
     }
-    case NONE: {
-      Crossover_ = new NoneCrossoverStrategy();
-      break;
+    if (bands != nullptr && se < best) {
+      best = se;
+      std::copy(bands, bands + best_bands.size(), best_bands.begin());
     }
   }
-  switch (selection_type) {
+
+  std::atomic<uint64_t> value{UINT64_MAX};
+  std::mutex mutex;
+  std::vector<uint64_t> errors;
+  // per band errors of the best child scanned in full, valid once best is set
+  uint64_t best = UINT64_MAX;
+  std::vector<uint64_t> best_bands;
+};
+
+Solver::Solver(Image image, const SolverOptions &options)
+    : pyramid_(BuildPyramid(image, options.coarse_levels + 1 + (options.racing_fraction > 0 ? kProxyLevels : 0))),
+      stall_generations_(options.stall_generations),
+      population_size_(options.population_size),
+      chromosome_size_(options.genome_size),
+      skip_alpha_(options.skip_alpha),
+      composite_cache_(options.composite_cache),
+      initialized_(true),
+      best_slot_(2 * options.population_size),
+      racing_fraction_(options.racing_fraction),
+      racing_z_(NormalQuantile(1.0 - clamp(options.racing_rejection_budget, 1e-6f, 0.5f))) {
+  float cleansing_rate = options.cleansing_rate;
+  if (options.early_abort && options.selection_type == TRUNCATION_SELECTION) {
+    // as many as TruncationSelection keeps
+    survivors_ = std::max<size_t>(1, population_size_ * (1 - cleansing_rate));
+  }
+  Crossover_ = CreateCrossover(options.crossover_type);
+  switch (options.selection_type) {
     case FITNESS_PROPORTIONATE_SELECTION: {
       Selection_ = new FitnessPropotionateSelection(cleansing_rate);
       break;
@@ -52,45 +110,75 @@ Solver::Solver(Image image, size_t population_size, size_t chromosome_size, floa
     }
   }
 
-  glGetTextureImage(image.texture, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer_size_, img_pixels_.get());
-  SetupBuffers_();
+  fitness_memo_ = options.fitness_memo;
+  seed_ = options.seed != 0 ? options.seed : RandomSeed();
+  Pool_ = new ThreadPool(options.threads);
+  PLOGI << "Solver " << this << " uses " << Pool_->GetThreadCount() << " threads and seed " << seed_;
+  Cutoff_ = new Cutoff();
+  bands_.resize(Pool_->GetThreadCount());
+  render_backend_ = options.render_backend;
+  level_ = std::min(options.coarse_levels, pyramid_.size() - 1);
+  image_ = pyramid_[level_];
+  CreateBackend_();
 
-  population_.reserve(population_size);
-  for (size_t i = 0; i < population_size; ++i) {
-    population_.emplace_back(Chromosome(chromosome_size));
-    population_[i].Draw(buffers_[i], image.width, image.height);
+  population_ = PopulationStore(population_size_, chromosome_size_);
+  Rng rng(seed_, 0);
+  for (size_t i = 0; i < population_size_; ++i) {
+    population_[i] = Chromosome(chromosome_size_, rng);
   }
-  CalcFitness_();
+  EvaluatePopulation_();
+  CacheElite_();
 }
 
 IterationResult Solver::Iteration() {
+  RefineLevel();
+  IterationResult result = Evolve();
+  result.texture = GetBestTexture();
+  return result;
+}
+
+void Solver::RefineLevel() {
+  if (level_ > 0 && stalled_ >= stall_generations_) {
+    SetLevel_(level_ - 1);
+  }
+}
+
+IterationResult Solver::Evolve() {
   IterationResult result = {0};
   result.iteration = ++iteration_;
   result.best_fitness = 0;
   result.worst_fitness = INFINITY;
+  result.level = level_;
 
   // generate new populaiton
-  std::vector<Chromosome> parents = (*Selection_)(population_);
-  for (size_t i = 0; i < population_size_; ++i) {
-    int idx1 = rand() % parents.size();
-    int idx2 = rand() % (parents.size() - 1);
-    if (idx2 >= idx1) {
-      ++idx2;
+  // selection and every child draw from their own stream of the generation, so children can be bred in any
+  // order on any thread
+  uint64_t stream = iteration_ * (population_size_ + 1);
+  Rng rng(seed_, stream);
+  (*Selection_)(population_.GetCurrent(), rng, parents_);
+  // the task captures no more than fits into std::function without a heap allocation
+  Pool_->ParallelFor(population_size_, [this, stream](size_t i, size_t) {
+    Rng child_rng(seed_, stream + 1 + i);
+    size_t idx1 = child_rng.Below(parents_.size());
+    // a second, different parent when there is one, a lone survivor is crossed with itself
+    size_t idx2 = idx1;
+    if (parents_.size() > 1) {
+      idx2 = child_rng.Below(parents_.size() - 1);
+      if (idx2 >= idx1) {
+        ++idx2;
+      }
     }
-    population_[i] = (*Crossover_)(parents[idx1].GetTriangles(), parents[idx2].GetTriangles());
-    population_[i].Mutate();
-    population_[i].Draw(buffers_[i], image_.width, image_.height);
-  }
-  CalcFitness_();
+    Chromosome &child = population_.GetNext()[i];
+    (*Crossover_)(population_[parents_[idx1]], population_[parents_[idx2]], child, child_rng);
+    child.Mutate(child_rng);
+  });
+  population_.Swap();
+  slot_base_ = population_size_ - slot_base_;
+  EvaluatePopulation_();
   for (size_t i = 0; i < population_size_; ++i) {
     float fitness = population_[i].GetFitness();
-    if (fitness > result.best_fitness) {
-      result.best_fitness = fitness;
-      result.texture = textures_[i];
-    }
     if (fitness > best_fitness_) {
-      glBlitNamedFramebuffer(buffers_[i], buffers_[population_size_], 0, 0, image_.width, image_.height, 0, 0,
-                             image_.width, image_.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+      Backend_->CopySlot(slot_base_ + i, best_slot_);
       best_fitness_ = fitness;
     }
     result.best_fitness = std::max(result.best_fitness, fitness);
@@ -98,15 +186,70 @@ IterationResult Solver::Iteration() {
     result.mean_fitness += fitness;
   }
   result.mean_fitness /= population_size_;
+  CacheElite_();
+
+  // improvements below 0.1% do not count, the tail of a level is not worth its generations
+  if (result.best_fitness > level_best_fitness_ * 1.001f) {
+    level_best_fitness_ = result.best_fitness;
+    stalled_ = 0;
+  } else {
+    ++stalled_;
+  }
 
   return result;
 }
 
+void Solver::CreateBackend_() {
+  pixel_count_ = static_cast<size_t>(image_.width) * image_.height;
+  Backend_ = CreateRenderBackend(render_backend_, image_.width, image_.height, best_slot_ + 1, Pool_);
+  Backend_->SetTarget(image_.pixels.data(), skip_alpha_);
+
+  proxy_level_ = std::min(level_ + kProxyLevels, pyramid_.size() - 1);
+  if (racing_fraction_ > 0 && proxy_level_ > level_) {
+    const Image &proxy = pyramid_[proxy_level_];
+    Proxy_ = new SoftwareRenderBackend(proxy.width, proxy.height, population_size_, Pool_);
+    proxy_fitness_.resize(population_size_);
+  }
+  racing_samples_ = 0;
+  known_.clear();
+
+  band_order_.resize((image_.height + kScanBand - 1) / kScanBand);
+  std::iota(band_order_.begin(), band_order_.end(), 0);
+  for (auto &bands : bands_) {
+    bands.resize(band_order_.size());
+  }
+  aborted_.assign(population_size_, false);
+}
+
+void Solver::SetLevel_(size_t level) {
+  PLOGI << "Solver " << this << " moves to level " << level << ", " << pyramid_[level].width << "x"
+        << pyramid_[level].height;
+  level_ = level;
+  image_ = pyramid_[level];
+  delete Backend_;
+  delete Proxy_;
+  Proxy_ = nullptr;
+  CreateBackend_();
+  slot_base_ = 0;
+  stalled_ = 0;
+
+  // the slots are gone and fitness values of different levels do not compare, so score everything again
+  for (auto &chromosome : population_.GetCurrent()) {
+    chromosome.SetRendered(Chromosome::kNoSlot, 0);
+  }
+  EvaluatePopulation_();
+  CacheElite_();
+  best_fitness_ = 0;
+  level_best_fitness_ = 0;
+}
+
 void Solver::Cleanup() {
   if (initialized_) {
-    PLOGI << "Deleting buffers for object " << this;
-    glDeleteBuffers(population_size_, buffers_.data());
-    glDeleteTextures(population_size_, textures_.data());
+    PLOGI << "Cleaning up object " << this;
+    delete Backend_;
+    delete Proxy_;
+    delete Cutoff_;
+    delete Pool_;
     delete Selection_;
     delete Crossover_;
   } else {
@@ -114,46 +257,347 @@ void Solver::Cleanup() {
   }
 }
 
-const std::vector<GLuint> &Solver::GetTextures() const {
-  return textures_;
+float Solver::GetBestFitness() const {
+  return best_fitness_;
 }
 
 GLuint Solver::GetBestTexture() const {
   if (initialized_) {
-    return textures_[population_size_];
+    return Backend_->GetTexture(best_slot_);
   } else {
     return -1;
   }
 }
 
-void Solver::CalcFitness_() {
+void Solver::Emigrate(size_t count, std::vector<Chromosome> &migrants) {
+  const std::vector<Chromosome> &population = population_.GetCurrent();
+  count = std::min(count, population_size_);
+  order_.resize(population_size_);
+  std::iota(order_.begin(), order_.end(), 0);
+  std::partial_sort(order_.begin(), order_.begin() + count, order_.end(), [&population](size_t a, size_t b) {
+    return population[a].GetFitness() > population[b].GetFitness();
+  });
+  migrants.resize(count);
+  for (size_t k = 0; k < count; ++k) {
+    migrants[k] = population[order_[k]];
+  }
+}
+
+void Solver::Immigrate(const std::vector<Chromosome> &migrants) {
+  const std::vector<Chromosome> &population = population_.GetCurrent();
+  size_t count = std::min(migrants.size(), population_size_);
+  order_.resize(population_size_);
+  std::iota(order_.begin(), order_.end(), 0);
+  std::partial_sort(order_.begin(), order_.begin() + count, order_.end(), [&population](size_t a, size_t b) {
+    return population[a].GetFitness() < population[b].GetFitness();
+  });
+  order_.resize(count);
+
+  // the migrants take the slots of the worst individuals, whose images must not be recalled any more
+  for (size_t k = 0; k < count; ++k) {
+    size_t i = order_[k];
+    uint64_t hash = population_[i].GetHash();
+    auto known = FindKnown_(hash);
+    if (known != known_.end() && known->hash == hash && known->slot == slot_base_ + i) {
+      known_.erase(known);
+    }
+    population_[i] = migrants[k];
+    population_[i].SetRendered(Chromosome::kNoSlot, 0);
+  }
+  EvaluateIndividuals_(order_);
+  for (size_t i : order_) {
+    const Chromosome &chromosome = population_[i];
+    if (fitness_memo_ && !aborted_[i]) {
+      Known known = {chromosome.GetHash(), slot_base_ + i, chromosome.GetSquaredError(), chromosome.GetFitness()};
+      auto at = FindKnown_(known.hash);
+      if (at != known_.end() && at->hash == known.hash) {
+        *at = known;
+      } else {
+        known_.insert(at, known);
+      }
+    }
+    if (chromosome.GetFitness() > best_fitness_) {
+      Backend_->CopySlot(slot_base_ + i, best_slot_);
+      best_fitness_ = chromosome.GetFitness();
+    }
+  }
+  CacheElite_();
+}
+
+void Solver::EvaluatePopulation_() {
+  RecallKnown_();
+  if (Proxy_ == nullptr) {
+    EvaluateIndividuals_(pending_);
+  } else {
+    RaceProxies_(pending_);
+    EvaluateIndividuals_(promoted_);
+    CalibrateProxies_(pending_, promoted_);
+  }
+  RememberKnown_();
+}
+
+void Solver::RecallKnown_() {
+  pending_.clear();
+  duplicates_.clear();
+  if (!fitness_memo_) {
+    for (size_t i = 0; i < population_size_; ++i) {
+      pending_.push_back(i);
+    }
+    return;
+  }
+  siblings_.clear();
   for (size_t i = 0; i < population_size_; ++i) {
-    glGetTextureImage(textures_[i], 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer_size_, cur_pixels_.get());
-    uint64_t se = 0;
-    int diff = 0;
-    for (size_t j = 0; j < buffer_size_; ++j) {
-      diff = cur_pixels_[j] - img_pixels_[j];
-      se += diff * diff;
-    }
-    double mse = static_cast<double>(se) / static_cast<double>(buffer_size_);
-    population_[i].SetFitness(static_cast<double>(buffer_size_) / mse);
-  }
-}
-
-void Solver::SetupBuffers_() {
-  PLOGI << "Setting up buffers for object " << this;
-  glGenFramebuffers(population_size_ + 1, buffers_.data());
-  glGenTextures(population_size_ + 1, textures_.data());
-
-  for (size_t i = 0; i <= population_size_; ++i) {
-    glBindFramebuffer(GL_FRAMEBUFFER, buffers_[i]);
-    glBindTexture(GL_TEXTURE_2D, textures_[i]);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image_.width, image_.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textures_[i], 0);
-    GLenum DrawBuffers[1] = {GL_COLOR_ATTACHMENT0};
-    glDrawBuffers(1, DrawBuffers);
-  }
-  glBindBuffer(GL_FRAMEBUFFER, 0);
-}
\ No newline at end of file
+    Chromosome &chromosome = population_[i];
+    uint64_t hash = chromosome.GetHash();
+    auto known = FindKnown_(hash);
+    if (known != known_.end() && known->hash == hash) {
+      Backend_->CopySlot(known->slot, slot_base_ + i);
+      chromosome.SetRendered(slot_base_ + i, known->squared_error);
+      chromosome.SetFitness(known->fitness);
+      aborted_[i] = false;
+    } else {
+      siblings_.emplace_back(hash, i);
+    }
+  }
+  // equal genomes end up next to each other, the first of them by index is scored and the rest copy it
+  std::sort(siblings_.begin(), siblings_.end());
+  size_t first = 0;
+  for (size_t k = 0; k < siblings_.size(); ++k) {
+    auto [hash, i] = siblings_[k];
+    if (k > 0 && hash == siblings_[k - 1].first) {
+      duplicates_.emplace_back(i, first);
+    } else {
+      first = i;
+      pending_.push_back(i);
+    }
+  }
+  std::sort(pending_.begin(), pending_.end());
+}
+
+void Solver::RememberKnown_() {
+  if (!fitness_memo_) {
+    return;
+  }
+  for (auto [i, sibling] : duplicates_) {
+    Chromosome &chromosome = population_[i];
+    chromosome.SetFitness(population_[sibling].GetFitness());
+    aborted_[i] = aborted_[sibling];
+    if (aborted_[i]) {
+      chromosome.SetRendered(Chromosome::kNoSlot, 0);
+    } else {
+      Backend_->CopySlot(slot_base_ + sibling, slot_base_ + i);
+      chromosome.SetRendered(slot_base_ + i, population_[sibling].GetSquaredError());
+    }
+  }
+  known_.clear();
+  for (size_t i = 0; i < population_size_; ++i) {
+    const Chromosome &chromosome = population_[i];
+    if (!aborted_[i]) {
+      known_.push_back({chromosome.GetHash(), slot_base_ + i, chromosome.GetSquaredError(), chromosome.GetFitness()});
+    }
+  }
+  // sorted by hash for binary search, one entry per genome
+  auto by_hash = [](const Known &a, const Known &b) { return a.hash < b.hash; };
+  std::sort(known_.begin(), known_.end(), by_hash);
+  auto same_hash = [](const Known &a, const Known &b) { return a.hash == b.hash; };
+  known_.erase(std::unique(known_.begin(), known_.end(), same_hash), known_.end());
+}
+
+std::vector<Solver::Known>::iterator Solver::FindKnown_(uint64_t hash) {
+  return std::lower_bound(known_.begin(), known_.end(), hash,
+                          [](const Known &known, uint64_t value) { return known.hash < value; });
+}
+
+void Solver::EvaluateIndividuals_(const std::vector<size_t> &indices) {
+  if (indices.empty()) {
+    return;
+  }
+  Cutoff_->Reset(survivors_, band_order_.size());
+  Cutoff *bound = survivors_ > 0 ? Cutoff_ : nullptr;
+  for (size_t i : indices) {
+    aborted_[i] = false;
+  }
+
+  if (Backend_->IsThreadSafe()) {
+    if (indices.size() >= Pool_->GetThreadCount()) {
+      // every worker renders and scores whole individuals into their own slots
+      Pool_->ParallelFor(indices.size(),
+                         [this, &indices](size_t k, size_t worker) { EvaluateChromosome_(indices[k], worker); });
+    } else {
+      // too few individuals to go around, let the backend spread each draw over the pool instead
+      for (size_t i : indices) {
+        EvaluateChromosome_(i, 0);
+      }
+    }
+  } else if (Backend_->CanComputeSquaredErrors()) {
+    // GL calls stay on this thread, only the sums come back so there is nothing to abort
+    errors_.resize(indices.size());
+    if (indices.size() == population_size_) {
+      Backend_->DrawBatch(population_.GetCurrent(), slot_base_);
+      Backend_->ComputeSquaredErrors(slot_base_, population_size_, errors_.data());
+    } else {
+      for (size_t k = 0; k < indices.size(); ++k) {
+        population_[indices[k]].Draw(*Backend_, slot_base_ + indices[k]);
+        Backend_->ComputeSquaredErrors(slot_base_ + indices[k], 1, &errors_[k]);
+      }
+    }
+    for (size_t k = 0; k < indices.size(); ++k) {
+      population_[indices[k]].SetRendered(slot_base_ + indices[k], errors_[k]);
+      population_[indices[k]].SetFitness(SquaredErrorFitness(errors_[k], pixel_count_, skip_alpha_));
+    }
+  } else {
+    // pixels have to come back: keep reads in flight so the transfer of individual i overlaps drawing
+    // individual i + 1 and scoring individual i - 1
+    const size_t lag = RenderBackend::kReadAhead;
+    for (size_t k = 0; k < indices.size() + lag; ++k) {
+      if (k < indices.size()) {
+        population_[indices[k]].Draw(*Backend_, slot_base_ + indices[k]);
+        Backend_->BeginReadPixels(slot_base_ + indices[k]);
+      }
+      if (k >= lag) {
+        size_t i = indices[k - lag];
+        bool complete;
+        uint64_t se = ScanSquaredError_(Backend_->EndReadPixels(slot_base_ + i), bound, bands_[0].data(), complete);
+        aborted_[i] = !complete;
+        // an aborted child's se is only a lower bound, so nothing may be derived from its image
+        population_[i].SetRendered(complete ? slot_base_ + i : Chromosome::kNoSlot, complete ? se : 0);
+        population_[i].SetFitness(SquaredErrorFitness(se, pixel_count_, skip_alpha_));
+      }
+    }
+  }
+
+  // children resemble their parents, so the bands the best one got wrong are where the next ones fail first
+  if (Cutoff_->best != UINT64_MAX) {
+    const std::vector<uint64_t> &best_bands = Cutoff_->best_bands;
+    std::sort(band_order_.begin(), band_order_.end(),
+              [&best_bands](size_t a, size_t b) { return best_bands[a] > best_bands[b]; });
+  }
+}
+
+void Solver::RaceProxies_(const std::vector<size_t> &candidates) {
+  auto score = [this, &candidates](size_t k, size_t) {
+    const Image &target = pyramid_[proxy_level_];
+    size_t i = candidates[k];
+    population_[i].Draw(*Proxy_, i);
+    uint64_t se = CalcSquaredError(target, Proxy_->GetPixels(i), {0, 0, target.width, target.height}, skip_alpha_);
+    proxy_fitness_[i] = SquaredErrorFitness(se, static_cast<size_t>(target.width) * target.height, skip_alpha_);
+  };
+  Pool_->ParallelFor(candidates.size(), score);
+
+  // until the proxy is calibrated everybody goes through
+  std::vector<size_t> &order = promoted_;
+  order.assign(candidates.begin(), candidates.end());
+  if (racing_samples_ < population_size_ || order.empty()) {
+    return;
+  }
+  std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return proxy_fitness_[a] > proxy_fitness_[b]; });
+
+  // a child is promoted when its proxy is within the noise of the last sure place, the difference of two
+  // noisy estimates has sqrt(2) times their deviation
+  size_t keep = std::max<size_t>(1, std::ceil(racing_fraction_ * order.size()));
+  keep = std::min(keep, order.size());
+  double cut = std::log(proxy_fitness_[order[keep - 1]]) - racing_z_ * std::sqrt(2.0 * racing_variance_);
+  while (keep < order.size() && std::log(proxy_fitness_[order[keep]]) >= cut) {
+    ++keep;
+  }
+  order.resize(keep);
+  std::sort(order.begin(), order.end());
+}
+
+void Solver::CalibrateProxies_(const std::vector<size_t> &candidates, const std::vector<size_t> &promoted) {
+  float lowest = INFINITY;
+  for (size_t i : promoted) {
+    if (aborted_[i]) {
+      // only a bound on its exact fitness
+      continue;
+    }
+    double d = std::log(population_[i].GetFitness()) - std::log(proxy_fitness_[i]);
+    // plain average of the first samples, then an exponentially weighted one
+    double weight = std::max(kRacingDecay, 1.0 / (racing_samples_ + 1));
+    double delta = d - racing_mean_;
+    racing_mean_ += weight * delta;
+    racing_variance_ = (1 - weight) * (racing_variance_ + weight * delta * delta);
+    ++racing_samples_;
+  }
+  for (size_t i : promoted) {
+    lowest = std::min(lowest, population_[i].GetFitness());
+  }
+
+  // rejected children keep their predicted fitness, strictly below every survivor, and no image. Both lists
+  // are in index order
+  auto next = promoted.begin();
+  for (size_t i : candidates) {
+    if (next != promoted.end() && *next == i) {
+      ++next;
+      continue;
+    }
+    float predicted = static_cast<float>(proxy_fitness_[i] * std::exp(racing_mean_));
+    population_[i].SetFitness(std::min(predicted, std::nextafter(lowest, 0.0f)));
+    population_[i].SetRendered(Chromosome::kNoSlot, 0);
+    aborted_[i] = true;
+  }
+}
+
+void Solver::EvaluateChromosome_(size_t i, size_t worker) {
+  Cutoff *cutoff = survivors_ > 0 ? Cutoff_ : nullptr;
+  Chromosome &chromosome = population_[i];
+  size_t slot = slot_base_ + i;
+  uint64_t se;
+  size_t parent = chromosome.GetRenderSlot();
+  Rect rect = chromosome.GetDirtyRect(image_.width, image_.height);
+  // copying the parent and redrawing more than half of the image is no cheaper than a full draw
+  if (parent != Chromosome::kNoSlot && 2 * rect.Area() <= pixel_count_ &&
+      Backend_->DrawRegion(chromosome, parent, slot, rect)) {
+    // the image only changed inside rect, so swap the parent's error there for the child's
+    se = chromosome.GetSquaredError() - CalcSquaredError(image_, Backend_->GetPixels(parent), rect, skip_alpha_) +
+         CalcSquaredError(image_, Backend_->GetPixels(slot), rect, skip_alpha_);
+    if (cutoff != nullptr) {
+      cutoff->Add(se, survivors_, nullptr);
+    }
+  } else {
+    chromosome.Draw(*Backend_, slot);
+    bool complete;
+    se = ScanSquaredError_(Backend_->GetPixels(slot), cutoff, bands_[worker].data(), complete);
+    if (!complete) {
+      // se is only a lower bound, so nothing may be derived from this image
+      aborted_[i] = true;
+      chromosome.SetRendered(Chromosome::kNoSlot, 0);
+      chromosome.SetFitness(SquaredErrorFitness(se, pixel_count_, skip_alpha_));
+      return;
+    }
+  }
+  chromosome.SetRendered(slot, se);
+  chromosome.SetFitness(SquaredErrorFitness(se, pixel_count_, skip_alpha_));
+}
+
+uint64_t Solver::ScanSquaredError_(const GLubyte *pixels, Cutoff *cutoff, uint64_t *bands, bool &complete) const {
+  complete = true;
+  if (cutoff == nullptr) {
+    return CalcSquaredError(image_, pixels, {0, 0, image_.width, image_.height}, skip_alpha_);
+  }
+  uint64_t se = 0;
+  for (size_t band : band_order_) {
+    int y0 = static_cast<int>(band) * kScanBand;
+    Rect rows = {0, y0, image_.width, std::min(image_.height, y0 + kScanBand)};
+    bands[band] = CalcSquaredError(image_, pixels, rows, skip_alpha_);
+    se += bands[band];
+    // survivors_ children are already better, whatever the remaining rows add
+    if (se > cutoff->value.load(std::memory_order_relaxed)) {
+      complete = false;
+      return se;
+    }
+  }
+  cutoff->Add(se, survivors_, bands);
+  return se;
+}
+
+void Solver::CacheElite_() {
+  if (!composite_cache_) {
+    return;
+  }
+  const std::vector<Chromosome> &population = population_.GetCurrent();
+  auto elite = std::max_element(population.begin(), population.end(),
+                                [](const Chromosome &a, const Chromosome &b) { return a.GetFitness() < b.GetFitness(); });
+  size_t i = elite - population.begin();
+  Backend_->CacheSlot(*elite, slot_base_ + i);
+}
@@ -0,0 +1,126 @@
+#include <SteadyStateSolver.hpp>
+#include <Fitness.hpp>
+#include <plog/Log.h>
+#include <algorithm>
+#include <cmath>
+
+SteadyStateSolver::SteadyStateSolver(Image image, const SolverOptions &options)
+    : image_(std::move(image)),
+      population_size_(std::max<size_t>(2, options.population_size)),
+      skip_alpha_(options.skip_alpha),
+      composite_cache_(options.composite_cache),
+      initialized_(true),
+      rng_(options.seed != 0 ? options.seed : RandomSeed()),
+      spare_slot_(population_size_) {
+  Crossover_ = CreateCrossover(options.crossover_type);
+  Pool_ = new ThreadPool(options.threads);
+  PLOGI << "SteadyStateSolver " << this << " uses " << Pool_->GetThreadCount() << " threads";
+  pixel_count_ = static_cast<size_t>(image_.width) * image_.height;
+  Backend_ = CreateRenderBackend(options.render_backend, image_.width, image_.height, population_size_ + 1, Pool_);
+  Backend_->SetTarget(image_.pixels.data(), skip_alpha_);
+
+  population_.reserve(population_size_);
+  heap_.resize(population_size_);
+  for (size_t i = 0; i < population_size_; ++i) {
+    population_.emplace_back(options.genome_size, rng_);
+    Chromosome &chromosome = population_.back();
+    uint64_t se = Evaluate_(chromosome, i);
+    chromosome.SetRendered(i, se);
+    chromosome.SetFitness(SquaredErrorFitness(se, pixel_count_, skip_alpha_));
+    if (se < population_[best_].GetSquaredError()) {
+      best_ = i;
+    }
+    heap_[i] = i;
+  }
+  child_ = population_[0];
+  std::make_heap(heap_.begin(), heap_.end(), [this](size_t a, size_t b) { return HeapLess_(a, b); });
+}
+
+IterationResult SteadyStateSolver::Iteration() {
+  IterationResult result = {0};
+  result.iteration = ++iteration_;
+  // children of the best individual are the most likely to make it in, so they get the cache
+  size_t best_slot = population_[best_].GetRenderSlot();
+  if (composite_cache_ && cached_slot_ != best_slot) {
+    Backend_->CacheSlot(population_[best_], best_slot);
+    cached_slot_ = best_slot;
+  }
+  for (size_t k = 0; k < population_size_; ++k) {
+    Step_();
+  }
+
+  result.worst_fitness = INFINITY;
+  for (const auto &chromosome : population_) {
+    float fitness = chromosome.GetFitness();
+    result.worst_fitness = std::min(result.worst_fitness, fitness);
+    result.mean_fitness += fitness;
+  }
+  result.mean_fitness /= population_size_;
+  result.best_fitness = population_[best_].GetFitness();
+  result.texture = Backend_->GetTexture(population_[best_].GetRenderSlot());
+  return result;
+}
+
+void SteadyStateSolver::Cleanup() {
+  if (initialized_) {
+    PLOGI << "Cleaning up object " << this;
+    delete Backend_;
+    delete Pool_;
+    delete Crossover_;
+  } else {
+    PLOGI << "Nothing to clean up";
+  }
+}
+
+GLuint SteadyStateSolver::GetBestTexture() const {
+  return Backend_->GetTexture(population_[best_].GetRenderSlot());
+}
+
+void SteadyStateSolver::Step_() {
+  size_t parent1 = tournament_.Pick(population_, rng_);
+  size_t parent2 = tournament_.Pick(population_, rng_);
+  (*Crossover_)(population_[parent1], population_[parent2], child_, rng_);
+  child_.Mutate(rng_);
+  uint64_t se = Evaluate_(child_, spare_slot_);
+
+  size_t worst = heap_.front();
+  if (se >= population_[worst].GetSquaredError()) {
+    return;
+  }
+  // the child takes the worst individual's place and its slot becomes the spare one
+  auto less = [this](size_t a, size_t b) { return HeapLess_(a, b); };
+  std::pop_heap(heap_.begin(), heap_.end(), less);
+  size_t slot = population_[worst].GetRenderSlot();
+  if (slot == cached_slot_) {
+    cached_slot_ = Chromosome::kNoSlot;
+  }
+  population_[worst] = child_;
+  population_[worst].SetRendered(spare_slot_, se);
+  population_[worst].SetFitness(SquaredErrorFitness(se, pixel_count_, skip_alpha_));
+  spare_slot_ = slot;
+  std::push_heap(heap_.begin(), heap_.end(), less);
+  if (se < population_[best_].GetSquaredError()) {
+    best_ = worst;
+  }
+}
+
+bool SteadyStateSolver::HeapLess_(size_t a, size_t b) const {
+  return population_[a].GetSquaredError() < population_[b].GetSquaredError();
+}
+
+uint64_t SteadyStateSolver::Evaluate_(Chromosome &chromosome, size_t slot) {
+  size_t parent = chromosome.GetRenderSlot();
+  if (parent != Chromosome::kNoSlot) {
+    Rect rect = chromosome.GetDirtyRect(image_.width, image_.height);
+    if (2 * rect.Area() <= pixel_count_ && Backend_->DrawRegion(chromosome, parent, slot, rect)) {
+      return chromosome.GetSquaredError() - CalcSquaredError(image_, Backend_->GetPixels(parent), rect, skip_alpha_) +
+             CalcSquaredError(image_, Backend_->GetPixels(slot), rect, skip_alpha_);
+    }
+  }
+  chromosome.Draw(*Backend_, slot);
+  uint64_t se;
+  if (!Backend_->ComputeSquaredErrors(slot, 1, &se)) {
+    se = CalcSquaredError(image_, Backend_->GetPixels(slot), {0, 0, image_.width, image_.height}, skip_alpha_);
+  }
+  return se;
+}
@@ -0,0 +1,99 @@
+#include <ThreadPool.hpp>
+#include <algorithm>
+
+namespace {
+thread_local int task_depth = 0;
+}
+
+ThreadPool::ThreadPool(size_t threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (size_t i = 1; i < threads; ++i) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop_, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+size_t ThreadPool::GetThreadCount() const {
+  return workers_.size() + 1;
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t, size_t)> &task) {
+  if (count == 0) {
+    return;
+  }
+  if (workers_.empty() || count == 1 || InTask()) {
+    ++task_depth;
+    for (size_t i = 0; i < count; ++i) {
+      task(i, 0);
+    }
+    --task_depth;
+    return;
+  }
+
+  // loops submitted by different threads take turns
+  std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    count_ = count;
+    next_ = 0;
+    done_ = 0;
+    ++generation_;
+  }
+  start_.notify_all();
+
+  RunTasks_(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  finish_.wait(lock, [this] { return done_ == count_ && active_ == 0; });
+  task_ = nullptr;
+}
+
+bool ThreadPool::InTask() {
+  return task_depth > 0;
+}
+
+void ThreadPool::WorkerLoop_(size_t worker) {
+  size_t seen = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) {
+        return;
+      }
+      seen = generation_;
+      if (task_ == nullptr) {
+        continue;
+      }
+      ++active_;
+    }
+    RunTasks_(worker);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --active_;
+    }
+    finish_.notify_one();
+  }
+}
+
+void ThreadPool::RunTasks_(size_t worker) {
+  ++task_depth;
+  for (size_t i = next_++; i < count_; i = next_++) {
+    (*task_)(i, worker);
+    ++done_;
+  }
+  --task_depth;
+}
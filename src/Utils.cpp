@@ -4,6 +4,7 @@
 #include <Utils.hpp>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
 #include <stb_image_resize.h>
 
 #include <cstdio>
@@ -11,30 +12,14 @@
 #include <fstream>
 #include <memory>
 
-float rand_float(float from, float to) {
-  float r = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
-  r = r * (to - from) + from;
-  return r;
-}
-
 float clamp(float value, float from, float to) {
   if (value < from) value = from;
   if (value > to) value = to;
   return value;
 }
 
-const char *schedule_names[9] = {"Geman & Geman, c = 1",
-                                 "Geman & Geman, c = 50",
-                                 "Geman & Geman, c = 195075",
-                                 "Linear",
-                                 "Staircase",
-                                 "Sigmoid",
-                                 "Geometric",
-                                 "Linear with reheat",
-                                 "Cosine"};
-
-bool LoadTextureFromFile(std::filesystem::path path, Image &image) {
-  PLOGI << "Loading texture from file \"" << path.string() << "\"";
+bool LoadImageFromFile(std::filesystem::path path, Image &image) {
+  PLOGI << "Loading image from file \"" << path.string() << "\"";
 
   std::ifstream ifs(path.string().c_str(), std::ifstream::binary);
   std::filebuf *pbuf = ifs.rdbuf();
@@ -59,6 +44,19 @@ bool LoadTextureFromFile(std::filesystem::path path, Image &image) {
     return false;
   }
 
+  image.width = image_width;
+  image.height = image_height;
+  image.pixels.assign(image_data, image_data + 4 * image_width * image_height);
+  stbi_image_free(image_data);
+  return true;
+}
+
+bool LoadTextureFromFile(std::filesystem::path path, Image &image) {
+  Image loaded;
+  if (!LoadImageFromFile(path, loaded)) {
+    return false;
+  }
+
   GLuint image_texture;
   glGenTextures(1, &image_texture);
   glBindTexture(GL_TEXTURE_2D, image_texture);
@@ -69,9 +67,66 @@ bool LoadTextureFromFile(std::filesystem::path path, Image &image) {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
   glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image_width, image_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, loaded.width, loaded.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               loaded.pixels.data());
 
-  image = {image_texture, image_width, image_height};
-  PLOGI << "Loaded texture #" << image_texture << ", " << image_width << "x" << image_height;
+  loaded.texture = image_texture;
+  image = std::move(loaded);
+  PLOGI << "Loaded texture #" << image.texture << ", " << image.width << "x" << image.height;
   return true;
 }
+
+std::vector<Image> BuildPyramid(const Image &image, size_t levels) {
+  std::vector<Image> pyramid;
+  pyramid.push_back(image);
+  pyramid[0].texture = -1;
+  while (pyramid.size() < levels && pyramid.back().width > 1 && pyramid.back().height > 1) {
+    // every level from the previous one, each a 2x reduction the resize filter handles well
+    const Image &finer = pyramid.back();
+    Image coarser;
+    coarser.width = finer.width / 2;
+    coarser.height = finer.height / 2;
+    coarser.pixels.resize(4 * static_cast<size_t>(coarser.width) * coarser.height);
+    stbir_resize_uint8(finer.pixels.data(), finer.width, finer.height, 0, coarser.pixels.data(), coarser.width,
+                       coarser.height, 0, 4);
+    pyramid.push_back(std::move(coarser));
+  }
+  return pyramid;
+}
+
+GLuint CompileShader(GLenum type, const char *source) {
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, NULL);
+  glCompileShader(shader);
+  GLint status;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (status != GL_TRUE) {
+    char log[1024];
+    glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+    PLOGE << "Failed to compile shader: " << log;
+    glDeleteShader(shader);
+    return 0;
+  }
+  return shader;
+}
+
+GLuint LinkProgram(std::initializer_list<GLuint> shaders) {
+  GLuint program = glCreateProgram();
+  for (GLuint shader : shaders) {
+    glAttachShader(program, shader);
+  }
+  glLinkProgram(program);
+  for (GLuint shader : shaders) {
+    glDetachShader(program, shader);
+  }
+  GLint status;
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  if (status != GL_TRUE) {
+    char log[1024];
+    glGetProgramInfoLog(program, sizeof(log), NULL, log);
+    PLOGE << "Failed to link program: " << log;
+    glDeleteProgram(program);
+    return 0;
+  }
+  return program;
+}
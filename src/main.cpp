@@ -1,6 +1,13 @@
 #include <Application.hpp>
+#include <Headless.hpp>
+#include <cstring>
 
 int main(int argc, char *argv[]) {
+  if (argc > 1 && std::strcmp(argv[1], "--headless") == 0) {
+    Headless headless(argc - 2, argv + 2);
+    return headless.Run();
+  }
+
   Application app;
   app.Run();
 
@@ -0,0 +1,72 @@
+#include <Chromosome.hpp>
+#include <Fitness.hpp>
+#include <HeadlessContext.hpp>
+#include <RenderBackend.hpp>
+#include <Rng.hpp>
+#include <TestImage.hpp>
+
+#include <cstdio>
+#include <vector>
+
+// The squared error reduction on the GL backends: it works on the same integers as the CPU kernel, so for
+// every slot it has to agree exactly with the error of the pixels read back.
+//
+// Exits with 77, which ctest reports as skipped, when no offscreen GL context or no compute shaders are there.
+
+namespace {
+
+const size_t kSlots = 8;
+const size_t kGenomeSize = 50;
+
+bool CheckBackend(bool layered, bool skip_alpha, const char *name) {
+  Image target = MakeTarget(64, 48);
+  OpenGLRenderBackend backend(target.width, target.height, kSlots, layered);
+  backend.SetTarget(target.pixels.data(), skip_alpha);
+  Rng rng(5, layered);
+  std::vector<Chromosome> chromosomes;
+  for (size_t i = 0; i < kSlots; ++i) {
+    chromosomes.emplace_back(kGenomeSize, rng);
+  }
+  backend.DrawBatch(chromosomes, 0);
+
+  // all slots at once, as a full generation is scored, and one at a time, as single children are
+  uint64_t batch[kSlots];
+  backend.ComputeSquaredErrors(0, kSlots, batch);
+  bool ok = true;
+  for (size_t slot = 0; slot < kSlots; ++slot) {
+    uint64_t single = 0;
+    backend.ComputeSquaredErrors(slot, 1, &single);
+    uint64_t expected =
+        CalcSquaredError(target, backend.GetPixels(slot), {0, 0, target.width, target.height}, skip_alpha);
+    if (batch[slot] != expected || single != expected) {
+      std::printf("%s: slot %zu has GPU squared errors %llu and %llu, the CPU one is %llu\n", name, slot,
+                  static_cast<unsigned long long>(batch[slot]), static_cast<unsigned long long>(single),
+                  static_cast<unsigned long long>(expected));
+      ok = false;
+    }
+  }
+  std::printf("%s: %s\n", name, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+}  // namespace
+
+int main() {
+  if (!HeadlessContext::MakeCurrent()) {
+    std::printf("no GL context, skipped\n");
+    return 77;
+  }
+  // the reduction needs compute shaders, without them the backend only takes a target it cannot use
+  Image target = MakeTarget(64, 48);
+  OpenGLRenderBackend probe(target.width, target.height, 1);
+  probe.SetTarget(target.pixels.data(), false);
+  if (!probe.CanComputeSquaredErrors()) {
+    std::printf("no compute shaders, skipped\n");
+    return 77;
+  }
+  bool ok = CheckBackend(false, false, "OpenGL");
+  ok = CheckBackend(false, true, "OpenGL, skipping alpha") && ok;
+  ok = CheckBackend(true, false, "OpenGL layered") && ok;
+  ok = CheckBackend(true, true, "OpenGL layered, skipping alpha") && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+#include <Engine.hpp>
+#include <Fitness.hpp>
+#include <HeadlessContext.hpp>
+#include <Solver.hpp>
+#include <TestImage.hpp>
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+// Islands breed on worker threads without the GL context. Once the best texture has been asked for, the
+// software backend must still keep it up to date, and only from the thread that asks for it: the texture has
+// to show an image at least as fit as the best one reported.
+//
+// Exits with 77, which ctest reports as skipped, when no offscreen GL context can be made.
+
+namespace {
+
+const size_t kIterations = 30;
+
+}  // namespace
+
+int main() {
+  if (!HeadlessContext::MakeCurrent()) {
+    std::printf("no GL context, skipped\n");
+    return 77;
+  }
+  Image target = MakeTarget(64, 48);
+  SolverOptions options;
+  options.render_backend = SOFTWARE;
+  options.population_size = 16;
+  options.genome_size = 30;
+  options.threads = 4;
+  options.seed = 3;
+  options.islands = 4;
+  options.migration_interval = 5;
+  options.fitness_memo = true;
+  std::unique_ptr<Engine> engine(CreateEngine(target, options));
+
+  // the texture exists before the islands run
+  engine->GetBestTexture();
+  std::vector<GLubyte> pixels(target.pixels.size());
+  size_t pixel_count = static_cast<size_t>(target.width) * target.height;
+  bool ok = true;
+  for (size_t iteration = 0; iteration < kIterations && ok; ++iteration) {
+    IterationResult result = engine->Iteration();
+    GLuint texture = engine->GetBestTexture();
+    if (result.texture != texture) {
+      std::printf("iteration %zu: the iteration shows another texture than the best one\n", iteration + 1);
+      ok = false;
+    }
+    glGetTextureImage(texture, 0, GL_RGBA, GL_UNSIGNED_BYTE, static_cast<GLsizei>(pixels.size()), pixels.data());
+    uint64_t se = CalcSquaredError(target, pixels.data(), {0, 0, target.width, target.height}, false);
+    double fitness = SquaredErrorFitness(se, pixel_count, false);
+    if (fitness < result.best_fitness * (1 - 1e-5)) {
+      std::printf("iteration %zu: the best texture has fitness %g, the best reported is %g\n", iteration + 1, fitness,
+                  result.best_fitness);
+      ok = false;
+    }
+  }
+  engine->Cleanup();
+  std::printf("%s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
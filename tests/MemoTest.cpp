@@ -0,0 +1,79 @@
+#include <HeadlessContext.hpp>
+#include <Solver.hpp>
+#include <TestImage.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// The fitness memo on the GL backends: every child scored there has to keep its slot and exact squared error,
+// or recalled genomes come back with stale errors. A run with the memo has to breed exactly the same
+// generations as one without it.
+//
+// Exits with 77, which ctest reports as skipped, when no offscreen GL context can be made.
+
+namespace {
+
+const size_t kGenerations = 30;
+
+bool CheckBackend(RenderBackendType backend, const char *name) {
+  Image target = MakeTarget(64, 48);
+  SolverOptions options;
+  options.render_backend = backend;
+  options.population_size = 16;
+  options.genome_size = 30;
+  options.threads = 1;
+  options.seed = 11;
+  SolverOptions memo_options = options;
+  memo_options.fitness_memo = true;
+
+  Solver plain(target, options);
+  Solver memo(target, memo_options);
+  bool ok = true;
+  for (size_t generation = 0; generation < kGenerations && ok; ++generation) {
+    IterationResult expected = plain.Evolve();
+    IterationResult result = memo.Evolve();
+    if (result.best_fitness != expected.best_fitness || result.mean_fitness != expected.mean_fitness ||
+        result.worst_fitness != expected.worst_fitness) {
+      std::printf("%s: generation %zu with the memo has best %g mean %g, without it best %g mean %g\n", name,
+                  generation, result.best_fitness, result.mean_fitness, expected.best_fitness,
+                  expected.mean_fitness);
+      ok = false;
+    }
+  }
+
+  // every individual is exactly scored and keeps the error its fitness was computed from
+  std::vector<Chromosome> individuals;
+  memo.Emigrate(options.population_size, individuals);
+  double samples = 4.0 * target.width * target.height;
+  for (const Chromosome &chromosome : individuals) {
+    if (chromosome.GetRenderSlot() == Chromosome::kNoSlot) {
+      std::printf("%s: a scored individual has no render slot\n", name);
+      ok = false;
+      break;
+    }
+    double fitness = samples * samples / static_cast<double>(chromosome.GetSquaredError());
+    if (std::abs(fitness - chromosome.GetFitness()) > 1e-5 * fitness) {
+      std::printf("%s: fitness %g does not match the squared error %llu\n", name, chromosome.GetFitness(),
+                  static_cast<unsigned long long>(chromosome.GetSquaredError()));
+      ok = false;
+      break;
+    }
+  }
+  plain.Cleanup();
+  memo.Cleanup();
+  std::printf("%s: %s\n", name, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+}  // namespace
+
+int main() {
+  if (!HeadlessContext::MakeCurrent()) {
+    std::printf("no GL context, skipped\n");
+    return 77;
+  }
+  bool ok = CheckBackend(OPENGL, "OpenGL");
+  ok = CheckBackend(OPENGL_LAYERED, "OpenGL layered") && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Utils.hpp>
+
+#include <cstddef>
+
+/**
+ * @brief Target shared by the tests, gradients in red and green over a checkerboard in blue
+ */
+inline Image MakeTarget(int width, int height) {
+  Image image;
+  image.width = width;
+  image.height = height;
+  image.pixels.resize(4 * static_cast<size_t>(width) * height);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      GLubyte *pixel = &image.pixels[4 * (static_cast<size_t>(y) * width + x)];
+      pixel[0] = static_cast<GLubyte>(255 * x / width);
+      pixel[1] = static_cast<GLubyte>(255 * y / height);
+      pixel[2] = static_cast<GLubyte>((x / 8 + y / 8) % 2 ? 200 : 40);
+      pixel[3] = 255;
+    }
+  }
+  return image;
+}